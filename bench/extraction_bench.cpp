@@ -0,0 +1,178 @@
+// Measures call graph extraction on a single translation unit.
+//
+// Usage: ./extraction_bench <file> [visitor|matcher|filtered|skip-bodies]
+//                           [compiler args...]
+//
+// The "matcher" mode runs the old hasAncestor based ASTMatcher extraction
+// (including its linear node lookup) so both implementations can be compared
+// on the same input; like it, "visitor" extracts every function, system
+// headers included. Run each mode in a separate process, peak RSS is
+// reported for the whole process.
+// "filtered" extracts with the default ExtractionOptions, which skip system
+// headers, and "skip-bodies" additionally sets skip_function_bodies.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang_interface.h"
+
+// Every heap allocation of the process is counted, to see how many of them
+// extraction performs.
+static std::atomic<size_t> heap_allocations{0};
+
+void* operator new(size_t size) {
+  heap_allocations++;
+  if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+namespace {
+
+class LegacyMatcherCallback
+    : public clang::ast_matchers::MatchFinder::MatchCallback {
+ private:
+  clang_interface::CallGraph& call_graph;
+  clang::ASTContext& ast_context;
+
+  clang_interface::FunctionDecl* GetOrAddNode(const clang::FunctionDecl* decl) {
+    auto existing = std::find_if(
+        begin(call_graph.nodes), end(call_graph.nodes),
+        [id = decl->getID()](const auto& n) { return n->ID() == id; });
+    if (existing != end(call_graph.nodes)) {
+      return *existing;
+    }
+    call_graph.nodes.push_back(
+        call_graph.arena.New<clang_interface::FunctionDecl>(
+            decl, ast_context.getFullLoc(decl->getBeginLoc()),
+            call_graph.arena));
+    return call_graph.nodes.back();
+  }
+
+ public:
+  LegacyMatcherCallback(clang_interface::CallGraph& cg,
+                        clang::ASTContext& ast_context)
+      : call_graph(cg), ast_context(ast_context) {}
+  void run(
+      const clang::ast_matchers::MatchFinder::MatchResult& Results) override {
+    auto caller_decl = Results.Nodes.getNodeAs<clang::FunctionDecl>("caller");
+    auto call_expr = Results.Nodes.getNodeAs<clang::CallExpr>("callee");
+    if (!caller_decl || !call_expr || !call_expr->getDirectCallee()) {
+      return;
+    }
+    auto caller_node = GetOrAddNode(caller_decl);
+    auto callee_node = GetOrAddNode(call_expr->getDirectCallee());
+    clang_interface::AddEdge(call_graph, {caller_node, callee_node});
+  }
+};
+
+clang_interface::CallGraph ExtractWithMatcher(clang_interface::ASTUnit& ast) {
+  using clang::ast_matchers::callExpr;
+  using clang::ast_matchers::functionDecl;
+  using clang::ast_matchers::hasAncestor;
+
+  clang_interface::CallGraph call_graph;
+  LegacyMatcherCallback callback(call_graph, ast.ASTContext());
+  clang::ast_matchers::MatchFinder finder;
+  finder.addMatcher(
+      callExpr(hasAncestor(functionDecl().bind("caller"))).bind("callee"),
+      &callback);
+  finder.matchAST(ast.ASTContext());
+  return call_graph;
+}
+
+long PeakRSSKilobytes() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " <file> [visitor|matcher|filtered|skip-bodies]"
+              << " [compiler args...]\n";
+    return 1;
+  }
+  std::ifstream in_file(argv[1]);
+  if (!in_file.is_open()) {
+    std::cerr << "Failed to open " << argv[1] << '\n';
+    return 1;
+  }
+  std::stringstream buffer;
+  buffer << in_file.rdbuf();
+
+  std::string mode = argc > 2 ? argv[2] : "visitor";
+  std::vector<std::string> compiler_args(argv + std::min(argc, 3),
+                                         argv + argc);
+
+  clang_interface::ExtractionOptions options;
+  // The matcher has no file filter, the visitor it is compared with neither
+  options.skip_system_headers = mode == "filtered" || mode == "skip-bodies";
+  options.skip_function_bodies = mode == "skip-bodies";
+
+  auto start = std::chrono::steady_clock::now();
+  auto ast = clang_interface::BuildASTFromSource(buffer.str(), compiler_args,
+                                                 options);
+  double parse_ms = MillisecondsSince(start);
+  long parse_rss = PeakRSSKilobytes();
+
+  size_t allocations_before = heap_allocations;
+  start = std::chrono::steady_clock::now();
+  auto call_graph = mode == "matcher"
+                        ? ExtractWithMatcher(ast)
+                        : clang_interface::ExtractCallGraphFromAST(
+                              ast, options);
+  double extract_ms = MillisecondsSince(start);
+  size_t extract_allocations = heap_allocations - allocations_before;
+
+  std::cout << "mode:            " << mode << '\n'
+            << "nodes:           " << call_graph.nodes.size() << '\n'
+            << "edges:           " << call_graph.edges.size() << '\n'
+            << "parse:           " << parse_ms << " ms\n"
+            << "extraction:      " << extract_ms << " ms\n"
+            << "peak RSS parse:  " << parse_rss << " KiB\n"
+            << "peak RSS total:  " << PeakRSSKilobytes() << " KiB\n";
+
+  auto arena = call_graph.arena.GetStats();
+  std::cout << "heap allocs:     " << extract_allocations
+            << " during extraction\n"
+            << "graph arena:     " << arena.allocations << " allocations in "
+            << arena.blocks << " blocks, " << arena.used_bytes << " of "
+            << arena.reserved_bytes << " bytes used\n";
+
+  auto strings = string_pool::GetStats();
+  std::cout << "interned:        " << strings.unique_strings << " unique of "
+            << strings.intern_calls << " strings\n"
+            << "string bytes:    " << strings.stored_bytes << " stored, "
+            << strings.requested_bytes << " without interning\n"
+            << "string arena:    " << strings.reserved_bytes << " bytes\n";
+
+  start = std::chrono::steady_clock::now();
+  call_graph = clang_interface::CallGraph();
+  std::cout << "graph release:   " << MillisecondsSince(start) << " ms\n";
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Measures the per-frame node transform, culling and hit-test kernels.
+//
+// Usage: ./node_kernels_bench [node count] [iterations]
+//
+// Every kernel the CPU supports runs over the same randomly laid out graph
+// (100k nodes by default, about half of them expanded) and its output is
+// checked against the scalar kernel.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "node_kernels.hpp"
+
+namespace {
+
+struct Output {
+  std::vector<float> screen_x;
+  std::vector<float> screen_y;
+  std::vector<uint8_t> on_screen;
+  size_t hit = node_kernels::NO_HIT;
+
+  explicit Output(size_t count)
+      : screen_x(count), screen_y(count), on_screen(count) {}
+
+  node_kernels::NodeOutput View() {
+    return {screen_x.data(), screen_y.data(), on_screen.data()};
+  }
+};
+
+bool SameOutput(const Output& a, const Output& b) {
+  return a.hit == b.hit && a.screen_x == b.screen_x &&
+         a.screen_y == b.screen_y && a.on_screen == b.on_screen;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t count = argc > 1 ? std::stoul(argv[1]) : 100000;
+  int iterations = argc > 2 ? std::stoi(argv[2]) : 1000;
+
+  // Layout positions are grid cells, as produced by GraphGui::layout.
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> column(0, 40);
+  std::uniform_int_distribution<int> row(0, 5000);
+  std::uniform_int_distribution<unsigned> parents(0, 1);
+  std::vector<float> layout_x(count), layout_y(count);
+  std::vector<unsigned> active_parents(count);
+  for (size_t i = 0; i < count; i++) {
+    layout_x[i] = column(random);
+    layout_y[i] = row(random);
+    active_parents[i] = parents(random);
+  }
+  // Make sure there is something under the mouse.
+  layout_x[count / 2] = 4;
+  layout_y[count / 2] = 450;
+  active_parents[count / 2] = 1;
+  node_kernels::NodeInput input = {layout_x.data(), layout_y.data(),
+                                   active_parents.data(), count};
+
+  node_kernels::FrameParams params;
+  params.scale_x = params.scale_y = 90;
+  params.offset_x = 25;
+  params.offset_y = -40000;
+  params.min_x = params.min_y = -60;
+  params.max_x = 1920;
+  params.max_y = 1080;
+  params.hit_test = true;
+  params.hit_x = 25 + 4 * 90 + 10;
+  params.hit_y = -40000 + 450 * 90 + 10;
+  params.hit_radius = 30;
+
+  Output reference(count);
+  auto reference_view = reference.View();
+  auto kernels = node_kernels::AvailableKernels();
+  reference.hit = kernels.front().function(input, params, reference_view);
+
+  std::cout << "nodes:      " << count << '\n'
+            << "iterations: " << iterations << '\n'
+            << "hit node:   "
+            << (reference.hit == node_kernels::NO_HIT
+                    ? std::string("none")
+                    : std::to_string(reference.hit))
+            << '\n';
+  bool all_match = true;
+  for (const auto& kernel : kernels) {
+    Output output(count);
+    auto view = output.View();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      output.hit = kernel.function(input, params, view);
+    }
+    double total_us = std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    bool match = SameOutput(output, reference);
+    all_match = all_match && match;
+    std::cout << kernel.name << ":\t" << total_us / iterations
+              << " us/frame, " << total_us * 1000 / iterations / count
+              << " ns/node" << (match ? "" : "  OUTPUT MISMATCH") << '\n';
+  }
+  return all_match ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#include "aggregation.hpp"
+
+#include <cstdint>
+
+namespace aggregation {
+
+std::string_view GroupName(const clang_interface::FunctionDecl* function,
+                           Level level) {
+  std::string_view name;
+  switch (level) {
+    case Level::Files:
+      name = function->FileName();
+      if (name.empty()) return "(unknown file)";
+      return name;
+    case Level::Directories: {
+      name = function->FileName();
+      if (name.empty()) return "(unknown file)";
+      auto separator = name.find_last_of('/');
+      if (separator == std::string_view::npos) return ".";
+      return string_pool::Intern(name.substr(0, separator));
+    }
+    case Level::Namespaces:
+      name = function->NamespaceAsString();
+      break;
+    case Level::Classes:
+      // Free functions end up in their namespace
+      name = function->ScopeAsString();
+      break;
+    case Level::Functions:
+      name = function->SignatureAsString();
+      break;
+  }
+  return name.empty() ? "(global)" : name;
+}
+
+Graph Aggregate(const clang_interface::CallGraphBatch& call_graph,
+                Level level) {
+  Graph graph;
+  std::unordered_map<std::string_view, unsigned> group_by_name;
+  for (auto function : call_graph.nodes) {
+    auto [it, inserted] = group_by_name.try_emplace(
+        GroupName(function, level), graph.names.size());
+    if (inserted) {
+      graph.names.push_back(it->first);
+      graph.representative.push_back(function);
+      graph.functions.push_back(0);
+    }
+    graph.functions[it->second]++;
+    graph.group_by_function_id[function->ID()] = it->second;
+    if (function->IsMain() && graph.main_group == NO_GROUP)
+      graph.main_group = it->second;
+  }
+
+  std::unordered_map<uint64_t, unsigned> edge_by_groups;
+  for (const auto& [caller, callee] : call_graph.edges) {
+    unsigned from = graph.group_by_function_id.at(caller->ID());
+    unsigned to = graph.group_by_function_id.at(callee->ID());
+    if (from == to) continue;
+    uint64_t key = static_cast<uint64_t>(from) << 32 | to;
+    auto [it, inserted] = edge_by_groups.try_emplace(key, graph.edges.size());
+    if (inserted) {
+      graph.edges.push_back({from, to, 0});
+    }
+    graph.edges[it->second].calls++;
+  }
+  return graph;
+}
+
+const Graph& Cache::Get(const clang_interface::CallGraphBatch& call_graph,
+                        Level level) {
+  if (call_graph.nodes.size() != node_count ||
+      call_graph.edges.size() != edge_count) {
+    Clear();
+    node_count = call_graph.nodes.size();
+    edge_count = call_graph.edges.size();
+  }
+  auto& graph = graphs[static_cast<int>(level)];
+  if (!graph) graph = std::make_unique<Graph>(Aggregate(call_graph, level));
+  return *graph;
+}
+
+void Cache::Clear() {
+  for (auto& graph : graphs) graph.reset();
+  node_count = 0;
+  edge_count = 0;
+}
+
+};  // namespace aggregation
@@ -0,0 +1,65 @@
+#ifndef AGGREGATION_HPP
+#define AGGREGATION_HPP
+
+#include <array>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "clang_interface.h"
+
+// Coarser views of a call graph: functions are grouped by file, directory,
+// namespace or class and the calls between groups are summed up.
+namespace aggregation {
+
+enum class Level { Functions, Files, Directories, Namespaces, Classes };
+constexpr int LEVEL_COUNT = 5;
+constexpr const char* LEVEL_NAMES[LEVEL_COUNT] = {
+    "Functions", "Files", "Directories", "Namespaces", "Classes"};
+
+constexpr unsigned NO_GROUP = ~0u;
+
+struct Edge {
+  unsigned from;
+  unsigned to;
+  unsigned calls;  // call graph edges between the two groups
+};
+
+struct Graph {
+  // Per group: interned name, first function merged into it and the number
+  // of functions it holds.
+  std::vector<std::string_view> names;
+  std::vector<clang_interface::FunctionDecl*> representative;
+  std::vector<unsigned> functions;
+  // Calls inside a group are left out.
+  std::vector<Edge> edges;
+  std::unordered_map<unsigned, unsigned> group_by_function_id;
+  unsigned main_group = NO_GROUP;
+};
+
+// Name of the group function belongs to at level, interned. At the
+// Functions level it is the function's signature.
+std::string_view GroupName(const clang_interface::FunctionDecl* function,
+                           Level level);
+
+// One pass over the nodes and one over the edges of call_graph.
+Graph Aggregate(const clang_interface::CallGraphBatch& call_graph,
+                Level level);
+
+// Aggregates of one growing call graph, each level computed on first use
+// and kept until nodes or edges are added.
+class Cache {
+ private:
+  std::array<std::unique_ptr<Graph>, LEVEL_COUNT> graphs;
+  size_t node_count = 0;
+  size_t edge_count = 0;
+
+ public:
+  const Graph& Get(const clang_interface::CallGraphBatch& call_graph,
+                   Level level);
+  void Clear();
+};
+
+};  // namespace aggregation
+
+#endif  // AGGREGATION_HPP
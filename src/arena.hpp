@@ -0,0 +1,145 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for objects that are all released together. Memory is handed
+// out from large blocks and only returned when the arena is destroyed or
+// reset, so throwing away a whole graph is a few deallocations instead of one
+// per object. Destructors are never run, hence only trivially destructible
+// types can be placed in an arena.
+class Arena {
+ public:
+  struct Stats {
+    size_t allocations = 0;
+    size_t blocks = 0;
+    size_t used_bytes = 0;
+    size_t reserved_bytes = 0;
+  };
+
+ private:
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks;
+  std::byte* cursor = nullptr;
+  size_t space = 0;
+  Stats stats;
+
+  std::byte* NewBlock(size_t size) {
+    // Not make_unique, that would zero the whole block
+    blocks.push_back(std::unique_ptr<std::byte[]>(new std::byte[size]));
+    stats.blocks++;
+    stats.reserved_bytes += size;
+    return blocks.back().get();
+  }
+
+ public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  Arena(Arena&& other) noexcept
+      : blocks(std::move(other.blocks)),
+        cursor(std::exchange(other.cursor, nullptr)),
+        space(std::exchange(other.space, 0)),
+        stats(std::exchange(other.stats, Stats())) {}
+  Arena& operator=(Arena&& other) noexcept {
+    blocks = std::move(other.blocks);
+    cursor = std::exchange(other.cursor, nullptr);
+    space = std::exchange(other.space, 0);
+    stats = std::exchange(other.stats, Stats());
+    return *this;
+  }
+
+  void* Allocate(size_t size, size_t alignment) {
+    stats.allocations++;
+    stats.used_bytes += size;
+    // Requests bigger than a quarter block get a block of their own so they
+    // don't waste the rest of the current one.
+    if (size > BLOCK_SIZE / 4) {
+      return NewBlock(size);
+    }
+    size_t padding = -reinterpret_cast<uintptr_t>(cursor) & (alignment - 1);
+    if (cursor == nullptr || padding + size > space) {
+      cursor = NewBlock(BLOCK_SIZE);
+      space = BLOCK_SIZE;
+      padding = 0;
+    }
+    std::byte* result = cursor + padding;
+    cursor = result + size;
+    space -= padding + size;
+    return result;
+  }
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Arena never runs destructors");
+    return new (Allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
+
+  // Uninitialized storage for count objects of type T.
+  template <typename T>
+  T* AllocateArray(size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "Arena never runs destructors");
+    if (count == 0) return nullptr;
+    return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  // NUL-terminated copy of str owned by the arena.
+  std::string_view CopyString(std::string_view str) {
+    char* data = AllocateArray<char>(str.size() + 1);
+    std::memcpy(data, str.data(), str.size());
+    data[str.size()] = '\0';
+    return std::string_view(data, str.size());
+  }
+
+  const Stats& GetStats() const { return stats; }
+};
+
+// Growable array whose storage lives in an Arena. Growing copies into a new
+// arena allocation twice the size, the old storage is only reclaimed with the
+// arena. Like everything in an arena it is trivially destructible.
+template <typename T>
+class ArenaVector {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "ArenaVector copies elements with memcpy");
+
+ private:
+  T* items = nullptr;
+  uint32_t count = 0;
+  uint32_t capacity = 0;
+
+ public:
+  void push_back(Arena& arena, const T& value) {
+    if (count == capacity) {
+      uint32_t new_capacity = std::max<uint32_t>(4, capacity * 2);
+      T* new_items = arena.AllocateArray<T>(new_capacity);
+      if (count > 0) std::memcpy(new_items, items, sizeof(T) * count);
+      items = new_items;
+      capacity = new_capacity;
+    }
+    items[count++] = value;
+  }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  T& operator[](size_t index) { return items[index]; }
+  const T& operator[](size_t index) const { return items[index]; }
+  T* begin() { return items; }
+  T* end() { return items + count; }
+  const T* begin() const { return items; }
+  const T* end() const { return items + count; }
+};
+
+#endif  // ARENA_HPP
@@ -3,13 +3,21 @@
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
-#include "clang/ASTMatchers/ASTMatchFinder.h"
-#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendAction.h"
+#include "clang/Lex/PreprocessorOptions.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/VirtualFileSystem.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 namespace clang_interface {
 
@@ -52,86 +60,280 @@ void AddEdge(CallGraph& call_graph, Edge edge) {
   call_graph.edges.emplace_back(std::move(edge));
 }
 
-class CallerCalleeFinderCallback
-    : public clang::ast_matchers::MatchFinder::MatchCallback {
+// Answers ExtractionOptions queries for source locations. The answer only
+// depends on the file, so it is computed once per FileID.
+class SourceFileFilter {
+ private:
+  const ExtractionOptions& options;
+  const clang::SourceManager& source_manager;
+  std::unordered_map<unsigned, bool> accepted_files;
+
+  static bool HasPrefix(llvm::StringRef file_name,
+                        const std::vector<std::string>& paths) {
+    return std::any_of(begin(paths), end(paths), [&](const auto& path) {
+      return file_name.startswith(path);
+    });
+  }
+
+  bool AcceptsFile(clang::FileID file_id, clang::SourceLocation loc) const {
+    if (file_id == source_manager.getMainFileID()) {
+      return true;
+    }
+    if (options.skip_system_headers && source_manager.isInSystemHeader(loc)) {
+      return false;
+    }
+    auto file_entry = source_manager.getFileEntryForID(file_id);
+    if (file_entry == nullptr) {
+      return options.include_paths.empty();
+    }
+    llvm::StringRef file_name = file_entry->getName();
+    if (!options.include_paths.empty() &&
+        !HasPrefix(file_name, options.include_paths)) {
+      return false;
+    }
+    return !HasPrefix(file_name, options.exclude_paths);
+  }
+
+ public:
+  SourceFileFilter(const ExtractionOptions& options,
+                   const clang::SourceManager& source_manager)
+      : options(options), source_manager(source_manager) {}
+
+  bool Accepts(const clang::Decl* decl) {
+    clang::SourceLocation loc = source_manager.getFileLoc(decl->getLocation());
+    if (loc.isInvalid()) {
+      return true;
+    }
+    clang::FileID file_id = source_manager.getFileID(loc);
+    auto [it, inserted] =
+        accepted_files.try_emplace(file_id.getHashValue(), false);
+    if (inserted) {
+      it->second = AcceptsFile(file_id, loc);
+    }
+    return it->second;
+  }
+};
+
+// Number of new nodes and edges collected before a batch is handed out.
+constexpr size_t CALL_GRAPH_BATCH_SIZE = 256;
+
+// Walks the translation unit once, top-down, keeping the chain of enclosing
+// function declarations on a stack. Every direct call found below a function
+// becomes an edge from the innermost enclosing function to the callee.
+class CallerCalleeVisitor
+    : public clang::RecursiveASTVisitor<CallerCalleeVisitor> {
  private:
   CallGraph& call_graph;
   clang::ASTContext& ast_context;
+  SourceFileFilter filter;
+  std::vector<const clang::FunctionDecl*> callers;
+  std::unordered_map<unsigned, FunctionDecl*> nodes_by_id;
+  const BatchCallback* on_batch;
+  CallGraphBatch pending;
+
+  FunctionDecl* GetOrAddNode(const clang::FunctionDecl* decl) {
+    auto [it, inserted] = nodes_by_id.try_emplace(decl->getID(), nullptr);
+    if (inserted) {
+      it->second = call_graph.arena.New<FunctionDecl>(
+          decl, ast_context.getFullLoc(decl->getBeginLoc()), call_graph.arena);
+      call_graph.nodes.push_back(it->second);
+      if (on_batch) pending.nodes.push_back(it->second);
+    }
+    return it->second;
+  }
+
  public:
-  CallerCalleeFinderCallback(clang_interface::CallGraph& cg, clang::ASTContext& ast_context) : call_graph(cg), ast_context(ast_context) {}
-  virtual void run(
-      const clang::ast_matchers::MatchFinder::MatchResult& Results) {
-    auto caller_decl = Results.Nodes.getNodeAs<clang::FunctionDecl>("caller");
-    auto callee_call_expr_decl =
-        Results.Nodes.getNodeAs<clang::CallExpr>("callee");
-    if (!caller_decl || !callee_call_expr_decl) {
-      return;
+  CallerCalleeVisitor(CallGraph& cg, clang::ASTContext& ast_context,
+                      const ExtractionOptions& options,
+                      const BatchCallback* on_batch)
+      : call_graph(cg),
+        ast_context(ast_context),
+        filter(options, ast_context.getSourceManager()),
+        on_batch(on_batch) {}
+
+  bool FlushBatch() {
+    if (!on_batch || (pending.nodes.empty() && pending.edges.empty())) {
+      return true;
     }
-    auto callee_decl = callee_call_expr_decl->getDirectCallee();
-    if (callee_decl == nullptr) {
-      return;
+    CallGraphBatch batch = std::move(pending);
+    pending = CallGraphBatch();
+    return (*on_batch)(std::move(batch));
+  }
+
+  bool shouldVisitTemplateInstantiations() const { return true; }
+  bool shouldVisitImplicitCode() const { return true; }
+
+  bool TraverseDecl(clang::Decl* decl) {
+    if (decl != nullptr && !filter.Accepts(decl)) {
+      return true;
     }
-    auto existing_caller_node = std::find_if(
-        begin(call_graph.nodes), end(call_graph.nodes),
-        [id = caller_decl->getID()](const auto& n) { return n->ID() == id; });
-
-    FunctionDecl* new_caller_node;
-    if (existing_caller_node == end(call_graph.nodes)) {
-      call_graph.nodes.emplace_back(
-          std::make_unique<clang_interface::FunctionDecl>(caller_decl, ast_context.getFullLoc(caller_decl->getBeginLoc())));
-      new_caller_node = call_graph.nodes.back().get();
-    } else {
-      new_caller_node = existing_caller_node->get();
+    auto function = llvm::dyn_cast_or_null<clang::FunctionDecl>(decl);
+    if (function == nullptr) {
+      return RecursiveASTVisitor::TraverseDecl(decl);
     }
+    callers.push_back(function);
+    bool result = RecursiveASTVisitor::TraverseDecl(decl);
+    callers.pop_back();
+    return result;
+  }
 
-    auto existing_callee_node = std::find_if(
-        begin(call_graph.nodes), end(call_graph.nodes),
-        [id = callee_decl->getID()](const auto& n) { return n->ID() == id; });
-
-    FunctionDecl* new_callee_node;
-    if (existing_callee_node == end(call_graph.nodes)) {
-      call_graph.nodes.emplace_back(
-          std::make_unique<clang_interface::FunctionDecl>(callee_decl, ast_context.getFullLoc(callee_decl->getBeginLoc())));
-      new_callee_node = call_graph.nodes.back().get();
-    } else {
-      new_callee_node = existing_callee_node->get();
+  bool VisitCallExpr(clang::CallExpr* call_expr) {
+    if (callers.empty()) {
+      return true;
+    }
+    auto callee_decl = call_expr->getDirectCallee();
+    if (callee_decl == nullptr || !filter.Accepts(callee_decl)) {
+      return true;
+    }
+    FunctionDecl* caller_node = GetOrAddNode(callers.back());
+    FunctionDecl* callee_node = GetOrAddNode(callee_decl);
+    AddEdge(call_graph, {caller_node, callee_node});
+    if (on_batch) {
+      pending.edges.push_back({caller_node, callee_node});
+      if (pending.nodes.size() + pending.edges.size() >=
+          CALL_GRAPH_BATCH_SIZE) {
+        return FlushBatch();
+      }
     }
+    return true;
+  }
+};  // CallerCalleeVisitor
+
+// Tells Sema to skip the bodies of functions declared in files the extraction
+// options reject. Only consulted when SkipFunctionBodies is enabled.
+class SkipRejectedBodiesConsumer : public clang::ASTConsumer {
+ private:
+  ExtractionOptions options;
+  SourceFileFilter filter;
+
+ public:
+  SkipRejectedBodiesConsumer(const ExtractionOptions& opts,
+                             const clang::SourceManager& source_manager)
+      : options(opts), filter(options, source_manager) {}
+
+  bool shouldSkipFunctionBody(clang::Decl* decl) override {
+    return !filter.Accepts(decl);
+  }
+};
+
+class SkipRejectedBodiesAction : public clang::ASTFrontendAction {
+ private:
+  const ExtractionOptions& options;
+
+ public:
+  explicit SkipRejectedBodiesAction(const ExtractionOptions& options)
+      : options(options) {}
+
+ protected:
+  std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(
+      clang::CompilerInstance& compiler, llvm::StringRef) override {
+    return std::make_unique<SkipRejectedBodiesConsumer>(
+        options, compiler.getSourceManager());
+  }
+};
+
+// Same job as the ASTBuilderAction behind buildASTFromCodeWithArgs, but the
+// unit is loaded through our own frontend action so SkipFunctionBodies can be
+// limited to rejected files.
+class SkipBodiesASTBuilder : public clang::tooling::ToolAction {
+ private:
+  const std::string& source;
+  const std::string& file_name;
+  const ExtractionOptions& options;
+  std::unique_ptr<clang::ASTUnit>& ast;
+
+ public:
+  SkipBodiesASTBuilder(const std::string& source, const std::string& file_name,
+                       const ExtractionOptions& options,
+                       std::unique_ptr<clang::ASTUnit>& ast)
+      : source(source), file_name(file_name), options(options), ast(ast) {}
+
+  bool runInvocation(
+      std::shared_ptr<clang::CompilerInvocation> invocation,
+      clang::FileManager*,
+      std::shared_ptr<clang::PCHContainerOperations> pch_container_ops,
+      clang::DiagnosticConsumer* diag_consumer) override {
+    invocation->getFrontendOpts().SkipFunctionBodies = true;
+    // The unit gets its own FileManager, so the in-memory source has to be
+    // handed over as a remapped file.
+    invocation->getPreprocessorOpts().addRemappedFile(
+        file_name,
+        llvm::MemoryBuffer::getMemBufferCopy(source, file_name).release());
+    auto diagnostics = clang::CompilerInstance::createDiagnostics(
+        &invocation->getDiagnosticOpts(), diag_consumer,
+        /*ShouldOwnClient=*/false);
 
-    AddEdge(call_graph, {new_caller_node, new_callee_node});
+    SkipRejectedBodiesAction action(options);
+    ast.reset(clang::ASTUnit::LoadFromCompilerInvocationAction(
+        std::move(invocation), std::move(pch_container_ops),
+        std::move(diagnostics), &action, /*Unit=*/nullptr,
+        /*Persistent=*/false));
+    return ast != nullptr;
   }
+};
 
-};  // CallerCalleeCallBack
+static std::unique_ptr<clang::ASTUnit> BuildASTSkippingBodies(
+    const std::string& source, const std::vector<std::string>& compiler_args,
+    const ExtractionOptions& options) {
+  const std::string file_name = "input.cc";
+  std::vector<std::string> command_line = {"clang-tool", "-fsyntax-only"};
+  command_line.insert(end(command_line), begin(compiler_args),
+                      end(compiler_args));
+  command_line.push_back(file_name);
+
+  llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> overlay_file_system(
+      new llvm::vfs::OverlayFileSystem(llvm::vfs::getRealFileSystem()));
+  llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> in_memory_file_system(
+      new llvm::vfs::InMemoryFileSystem);
+  overlay_file_system->pushOverlay(in_memory_file_system);
+  llvm::IntrusiveRefCntPtr<clang::FileManager> files(
+      new clang::FileManager(clang::FileSystemOptions(), overlay_file_system));
+  // The driver checks that the input exists before building the invocation.
+  in_memory_file_system->addFile(
+      file_name, 0, llvm::MemoryBuffer::getMemBufferCopy(source));
+
+  std::unique_ptr<clang::ASTUnit> ast;
+  SkipBodiesASTBuilder builder(source, file_name, options, ast);
+  clang::tooling::ToolInvocation invocation(command_line, &builder,
+                                            files.get());
+  invocation.run();
+  return ast;
+}
 
 ASTUnit BuildASTFromSource(const std::string& source,
-                           std::vector<std::string> compiler_args) {
+                           std::vector<std::string> compiler_args,
+                           const ExtractionOptions& options) {
   compiler_args.push_back("-std=c++17");
   compiler_args.push_back("-nostdinc++");
   compiler_args.push_back("-v");
+  if (options.skip_function_bodies) {
+    return ASTUnit(BuildASTSkippingBodies(source, compiler_args, options));
+  }
   ASTUnit ast(clang::tooling::buildASTFromCodeWithArgs(source, compiler_args));
   return ast;
 }
 
-clang_interface::CallGraph ExtractCallGraphFromAST(ASTUnit& ast) {
+clang_interface::CallGraph ExtractCallGraphFromAST(
+    ASTUnit& ast, const ExtractionOptions& options) {
   CallGraph call_graph;
-  clang_interface::CallerCalleeFinderCallback Callback(call_graph, ast.ASTContext());
-  clang::ast_matchers::MatchFinder Finder;
-
-  using clang::ast_matchers::callExpr;
-  using clang::ast_matchers::functionDecl;
-  using clang::ast_matchers::hasAncestor;
-
-  Finder.addMatcher(
-      callExpr(hasAncestor(functionDecl().bind("caller"))).bind("callee"),
-      &Callback);
-
-  Finder.matchAST(ast.ASTContext());
+  CallerCalleeVisitor visitor(call_graph, ast.ASTContext(), options, nullptr);
+  visitor.TraverseDecl(ast.ASTContext().getTranslationUnitDecl());
   return call_graph;
 }
 
+bool ExtractCallGraphFromAST(ASTUnit& ast, CallGraph& call_graph,
+                             const ExtractionOptions& options,
+                             const BatchCallback& on_batch) {
+  CallerCalleeVisitor visitor(call_graph, ast.ASTContext(), options,
+                              &on_batch);
+  return visitor.TraverseDecl(ast.ASTContext().getTranslationUnitDecl()) &&
+         visitor.FlushBatch();
+}
+
 clang_interface::CallGraph ExtractCallGraphFromSource(
-    const std::string& source) {
-  ASTUnit ast = BuildASTFromSource(source);
-  return ExtractCallGraphFromAST(ast);
+    const std::string& source, const ExtractionOptions& options) {
+  ASTUnit ast = BuildASTFromSource(source, {}, options);
+  return ExtractCallGraphFromAST(ast, options);
 }
 
 };  // namespace clang_interface
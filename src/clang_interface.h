@@ -1,9 +1,11 @@
 #ifndef CLANG_INTERFACE_H
 #define CLANG_INTERFACE_H
 
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTContext.h"
@@ -12,7 +14,9 @@
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/Tooling/Tooling.h"
 #include "clang/Basic/SourceLocation.h"
+#include "arena.hpp"
 #include "llvm/Support/raw_ostream.h"
+#include "string_pool.hpp"
 
 #define DUMP(out, x) out << #x << ' ' << x << '\n'
 
@@ -28,63 +32,130 @@ class ASTUnit {
 
   auto& ASTContext() { return ast->getASTContext(); }
   const auto& ASTContext() const { return ast->getASTContext(); }
+  operator bool() const { return ast != nullptr; }
 };
 
 class ParamVarDecl {
  private:
   const clang::ParmVarDecl* decl{nullptr};
-  std::string name;
-  std::string type;
+  unsigned id{0};
+  std::string_view name;
+  std::string_view type;
   clang::FullSourceLoc full_source_loc;
  public:
   ParamVarDecl() = default;
   explicit ParamVarDecl(const clang::ParmVarDecl* p, unsigned index)
       : decl(p),
-        name(p->getNameAsString()),
-        type(decl->getOriginalType().getAsString()) {}
-  unsigned ID() const { return decl->getID(); }
-  const std::string& NameAsString() const { return name; }
-  const std::string& TypeAsString() const { return type; }
+        id(p->getID()),
+        name(string_pool::Intern(p->getNameAsString())),
+        type(string_pool::Intern(decl->getOriginalType().getAsString())) {}
+  unsigned ID() const { return id; }
+  // Interned, data() is NUL-terminated.
+  std::string_view NameAsString() const { return name; }
+  std::string_view TypeAsString() const { return type; }
   operator bool() const { return decl; }
 };
 
+// Everything the GUI reads is copied out of the AST when the node is created
+// on the extraction thread. The GUI thread must not call into clang objects,
+// the worker may still be allocating in the same ASTContext and SourceManager.
 class FunctionDecl {
  private:
   const clang::FunctionDecl* decl{nullptr};
-  std::string name;
-  std::string return_type;
-  std::vector<ParamVarDecl> params;
-  std::string ast_dump;
-  clang::FullSourceLoc full_source_loc;
+  unsigned id{0};
+  bool is_main{false};
+  unsigned line{0};
+  std::string_view name;
+  std::string_view qualified_name;
+  std::string_view scope;
+  std::string_view enclosing_namespace;
+  std::string_view signature;
+  std::string_view file;
+  bool in_main_file{false};
+  std::string_view return_type;
+  ParamVarDecl* params{nullptr};
+  unsigned param_count{0};
+  std::string_view ast_dump;
 
  public:
   FunctionDecl() = default;
-  explicit FunctionDecl(const clang::FunctionDecl* arg, clang::FullSourceLoc source_loc)
+  // Parameters and the AST dump are allocated from the graph's arena.
+  explicit FunctionDecl(const clang::FunctionDecl* arg,
+                        clang::FullSourceLoc source_loc, Arena& arena)
       : decl(arg),
-        name(arg->getNameAsString()),
-        return_type(arg->getReturnType().getAsString()),
-        full_source_loc(source_loc) {
-    unsigned i = 0;
+        id(arg->getID()),
+        is_main(arg->isMain()),
+        name(string_pool::Intern(arg->getNameAsString())),
+        qualified_name(string_pool::Intern(arg->getQualifiedNameAsString())),
+        return_type(string_pool::Intern(arg->getReturnType().getAsString())),
+        params(arena.AllocateArray<ParamVarDecl>(arg->getNumParams())) {
     for (auto param = arg->param_begin(); param != arg->param_end(); ++param) {
-      params.emplace_back(*param, ++i);
+      new (&params[param_count]) ParamVarDecl(*param, param_count + 1);
+      param_count++;
+    }
+    scope = string_pool::Intern(
+        qualified_name.size() > name.size() + 2
+            ? qualified_name.substr(0, qualified_name.size() - name.size() - 2)
+            : std::string_view());
+    std::string namespace_name;
+    for (auto context = arg->getDeclContext(); context != nullptr;
+         context = context->getParent()) {
+      if (auto space = llvm::dyn_cast<clang::NamespaceDecl>(context)) {
+        namespace_name = space->getQualifiedNameAsString();
+        break;
+      }
+    }
+    enclosing_namespace = string_pool::Intern(namespace_name);
+    std::string file_name;
+    if (source_loc.isValid()) {
+      const auto& source_manager = source_loc.getManager();
+      auto file_loc = source_manager.getFileLoc(source_loc);
+      file_name = source_manager.getFilename(file_loc).str();
+      in_main_file = source_manager.isInMainFile(file_loc);
+      line = source_loc.getLineNumber();
     }
-    llvm::raw_string_ostream out(ast_dump);
+    file = string_pool::Intern(file_name);
+    std::string compact(qualified_name);
+    compact += '(';
+    for (unsigned i = 0; i < param_count; i++) {
+      if (i > 0) compact += ", ";
+      compact += params[i].TypeAsString();
+    }
+    compact += ')';
+    signature = string_pool::Intern(compact);
+    std::string dump;
+    llvm::raw_string_ostream out(dump);
     arg->dump(out);
-    out.str();
-
+    ast_dump = arena.CopyString(out.str());
   }
-  const std::string& ASTDump() const { return ast_dump; }
-  unsigned ID() const { return decl->getID(); }
-  const std::string& NameAsString() const { return name; }
-  const std::string& ReturnTypeAsString() const { return return_type; }
-
-  const clang::FullSourceLoc& FullSourceLoc() const { return full_source_loc; }
-	
-  auto ParamBegin() const { return params.begin(); }
-  auto ParamEnd() const { return params.end(); }
+  // Owned by the graph's arena, data() is NUL-terminated.
+  std::string_view ASTDump() const { return ast_dump; }
+  unsigned ID() const { return id; }
+  // Interned, data() is NUL-terminated.
+  std::string_view NameAsString() const { return name; }
+  // Including enclosing namespaces and classes, e.g. "ns::Class::method".
+  std::string_view QualifiedNameAsString() const { return qualified_name; }
+  // The enclosing namespaces and classes, "ns::Class", empty at file scope.
+  std::string_view ScopeAsString() const { return scope; }
+  // The innermost enclosing namespace, "ns", empty in the global namespace.
+  std::string_view NamespaceAsString() const { return enclosing_namespace; }
+  // File the declaration was spelled in, empty when unknown.
+  std::string_view FileName() const { return file; }
+  // Declared in the parsed source itself rather than an included file, so
+  // its line numbers refer to the editor's buffer.
+  bool IsInMainFile() const { return in_main_file; }
+  // Qualified name and parameter types, "ns::Class::method(int, char *)",
+  // tells overloads apart.
+  std::string_view SignatureAsString() const { return signature; }
+  std::string_view ReturnTypeAsString() const { return return_type; }
+  // Line of the declaration in its file, 0 when unknown.
+  unsigned LineNumber() const { return line; }
+
+  const ParamVarDecl* ParamBegin() const { return params; }
+  const ParamVarDecl* ParamEnd() const { return params + param_count; }
 
   bool HasParams() const { return ParamBegin() != ParamEnd(); }
-  bool IsMain() const { return decl->isMain(); }
+  bool IsMain() const { return is_main; }
   operator bool() const { return decl; }
 };
 
@@ -93,26 +164,60 @@ struct Edge {
   clang_interface::FunctionDecl* callee;
 };
 
+// Controls which source files take part in call graph extraction. Functions
+// declared in a rejected file are never turned into FunctionDecl nodes and
+// calls into them are dropped. The main file is always accepted. Paths are
+// matched as prefixes of the file name clang opened the header with.
+//
+// With skip_function_bodies set, BuildASTFromSource does not parse the bodies
+// of functions in rejected files at all; their declarations are kept so calls
+// from accepted files still resolve.
+struct ExtractionOptions {
+  bool skip_system_headers = true;
+  bool skip_function_bodies = false;
+  std::vector<std::string> include_paths;  // empty accepts every path
+  std::vector<std::string> exclude_paths;
+};
+
+// All FunctionDecl objects of a graph, with their parameters and AST dumps,
+// live in its arena and are released together with the graph.
 struct CallGraph {
-  using NodesList = std::vector<std::unique_ptr<FunctionDecl>>;
+  using NodesList = std::vector<FunctionDecl*>;
   using EdgesList = std::vector<Edge>;
 
+  Arena arena;
   NodesList nodes;
   EdgesList edges;
 };
 
+// Nodes and edges found since the previous batch. Edges only reference nodes
+// of the same or an earlier batch.
+struct CallGraphBatch {
+  std::vector<FunctionDecl*> nodes;
+  std::vector<Edge> edges;
+};
+
+// Receives every batch while the extraction runs, returning false stops it.
+using BatchCallback = std::function<bool(CallGraphBatch)>;
+
 std::ostream& operator<<(std::ostream&, const ParamVarDecl&);
 std::ostream& operator<<(std::ostream&, const FunctionDecl&);
 std::ostream& operator<<(std::ostream&, const Edge&);
 std::ostream& operator<<(std::ostream&, const CallGraph&);
 
 ASTUnit BuildASTFromSource(const std::string& source,
-                           std::vector<std::string> compiler_args = {});
+                           std::vector<std::string> compiler_args = {},
+                           const ExtractionOptions& options = {});
 void AddEdge(CallGraph& call_graph, Edge edge);
 std::optional<clang_interface::FunctionDecl> FindNodeWithId(
     const CallGraph& call_graph, unsigned id);
-CallGraph ExtractCallGraphFromAST(ASTUnit& ast);
-CallGraph ExtractCallGraphFromSource(const std::string& source);
+CallGraph ExtractCallGraphFromAST(ASTUnit& ast,
+                                  const ExtractionOptions& options = {});
+bool ExtractCallGraphFromAST(ASTUnit& ast, CallGraph& call_graph,
+                             const ExtractionOptions& options,
+                             const BatchCallback& on_batch);
+CallGraph ExtractCallGraphFromSource(const std::string& source,
+                                     const ExtractionOptions& options = {});
 // CallGraph ExtractCallGraphFromFile(const std::string& file_name);
 
 };  // namespace clang_interface
@@ -0,0 +1,205 @@
+#include "edge_bundling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+namespace edge_bundling {
+
+namespace {
+
+constexpr float EPSILON = 1e-4f;
+
+struct Vec {
+  float x, y;
+};
+
+Vec operator-(Vec a, Vec b) { return {a.x - b.x, a.y - b.y}; }
+Vec operator+(Vec a, Vec b) { return {a.x + b.x, a.y + b.y}; }
+Vec operator*(Vec a, float s) { return {a.x * s, a.y * s}; }
+float Dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y; }
+float Length(Vec a) { return std::sqrt(Dot(a, a)); }
+
+Vec Start(const Segment& s) { return {s.start_x, s.start_y}; }
+Vec End(const Segment& s) { return {s.end_x, s.end_y}; }
+Vec Midpoint(const Segment& s) { return (Start(s) + End(s)) * 0.5f; }
+
+// How far the projection of q onto p's line overlaps p, 1 when the middles
+// coincide and 0 when they are further apart than half of p.
+float Visibility(const Segment& p, const Segment& q) {
+  Vec p_start = Start(p);
+  Vec direction = End(p) - p_start;
+  float length_sq = Dot(direction, direction);
+  auto project = [&](Vec point) {
+    return p_start + direction * (Dot(point - p_start, direction) / length_sq);
+  };
+  Vec i0 = project(Start(q));
+  Vec i1 = project(End(q));
+  float span = Length(i1 - i0);
+  if (span < EPSILON) return 0.f;
+  Vec i_mid = (i0 + i1) * 0.5f;
+  return std::max(0.f, 1.f - 2.f * Length(Midpoint(p) - i_mid) / span);
+}
+
+float Compatibility(const Segment& p, const Segment& q) {
+  Vec p_vector = End(p) - Start(p);
+  Vec q_vector = End(q) - Start(q);
+  float p_length = Length(p_vector);
+  float q_length = Length(q_vector);
+  float average = (p_length + q_length) / 2;
+
+  float angle = std::abs(Dot(p_vector, q_vector) / (p_length * q_length));
+  float scale = 2.f / (average / std::min(p_length, q_length) +
+                       std::max(p_length, q_length) / average);
+  float position =
+      average / (average + Length(Midpoint(p) - Midpoint(q)));
+  float visibility = std::min(Visibility(p, q), Visibility(q, p));
+  return angle * scale * position * visibility;
+}
+
+// Partner edges running the opposite way are stored with this bit set, their
+// points are matched in reverse order.
+constexpr uint32_t REVERSED = 1u << 31;
+
+// Partner lists per edge, found through a grid over the edge midpoints.
+std::vector<std::vector<uint32_t>> FindPartners(
+    const std::vector<Segment>& edges, const std::vector<float>& lengths,
+    const Options& options, const std::atomic<bool>& cancelled) {
+  auto cell_of = [&](float position) {
+    return static_cast<int32_t>(std::floor(position / options.search_radius));
+  };
+  auto key = [](int32_t x, int32_t y) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 |
+           static_cast<uint32_t>(y);
+  };
+  std::unordered_map<uint64_t, std::vector<uint32_t>> grid;
+  for (uint32_t i = 0; i < edges.size(); i++) {
+    if (lengths[i] < EPSILON) continue;
+    Vec mid = Midpoint(edges[i]);
+    grid[key(cell_of(mid.x), cell_of(mid.y))].push_back(i);
+  }
+
+  std::vector<std::vector<uint32_t>> partners(edges.size());
+  std::vector<std::pair<float, uint32_t>> candidates;
+  for (uint32_t i = 0; i < edges.size() && !cancelled; i++) {
+    if (lengths[i] < EPSILON) continue;
+    Vec mid = Midpoint(edges[i]);
+    int32_t cell_x = cell_of(mid.x);
+    int32_t cell_y = cell_of(mid.y);
+    candidates.clear();
+    for (int32_t x = cell_x - 1; x <= cell_x + 1; x++) {
+      for (int32_t y = cell_y - 1; y <= cell_y + 1; y++) {
+        auto cell = grid.find(key(x, y));
+        if (cell == grid.end()) continue;
+        for (uint32_t j : cell->second) {
+          if (j == i) continue;
+          float compatibility = Compatibility(edges[i], edges[j]);
+          if (compatibility < options.compatibility_threshold) continue;
+          bool reversed = Dot(End(edges[i]) - Start(edges[i]),
+                              End(edges[j]) - Start(edges[j])) < 0;
+          candidates.emplace_back(compatibility, reversed ? j | REVERSED : j);
+        }
+      }
+    }
+    size_t count = std::min(candidates.size(), options.max_partners);
+    std::partial_sort(begin(candidates), begin(candidates) + count,
+                      end(candidates), [](const auto& a, const auto& b) {
+                        return a.first > b.first;
+                      });
+    for (size_t k = 0; k < count; k++)
+      partners[i].push_back(candidates[k].second);
+  }
+  return partners;
+}
+
+// Inserts a point in the middle of every polyline span.
+void Subdivide(std::vector<Vec>& points, size_t edge_count,
+               size_t& points_per_edge) {
+  size_t new_points_per_edge = 2 * points_per_edge - 1;
+  std::vector<Vec> subdivided(edge_count * new_points_per_edge);
+  for (size_t e = 0; e < edge_count; e++) {
+    const Vec* old_points = &points[e * points_per_edge];
+    Vec* new_points = &subdivided[e * new_points_per_edge];
+    for (size_t k = 0; k + 1 < points_per_edge; k++) {
+      new_points[2 * k] = old_points[k];
+      new_points[2 * k + 1] = (old_points[k] + old_points[k + 1]) * 0.5f;
+    }
+    new_points[new_points_per_edge - 1] = old_points[points_per_edge - 1];
+  }
+  points = std::move(subdivided);
+  points_per_edge = new_points_per_edge;
+}
+
+}  // namespace
+
+Result Bundle(const std::vector<Segment>& edges, const Options& options,
+              const std::atomic<bool>& cancelled) {
+  size_t edge_count = edges.size();
+  std::vector<float> lengths(edge_count);
+  for (size_t e = 0; e < edge_count; e++)
+    lengths[e] = Length(End(edges[e]) - Start(edges[e]));
+
+  auto partners = FindPartners(edges, lengths, options, cancelled);
+
+  size_t points_per_edge = 2;
+  std::vector<Vec> points(edge_count * points_per_edge);
+  for (size_t e = 0; e < edge_count; e++) {
+    points[2 * e] = Start(edges[e]);
+    points[2 * e + 1] = End(edges[e]);
+  }
+
+  std::vector<Vec> forces;
+  float step = options.step;
+  float iterations = options.iterations;
+  for (int cycle = 0; cycle < options.cycles; cycle++) {
+    Subdivide(points, edge_count, points_per_edge);
+    forces.assign(points.size(), Vec{0, 0});
+    size_t segments = points_per_edge - 1;
+
+    for (int iteration = 0; iteration < static_cast<int>(iterations);
+         iteration++) {
+      if (cancelled) return Result();
+      for (size_t e = 0; e < edge_count; e++) {
+        if (lengths[e] < EPSILON) continue;
+        const Vec* p = &points[e * points_per_edge];
+        Vec* f = &forces[e * points_per_edge];
+        float spring = options.stiffness / (lengths[e] * segments);
+        for (size_t k = 1; k + 1 < points_per_edge; k++) {
+          Vec force = ((p[k - 1] - p[k]) + (p[k + 1] - p[k])) * spring;
+          for (uint32_t partner : partners[e]) {
+            size_t other = partner & ~REVERSED;
+            size_t other_k =
+                partner & REVERSED ? points_per_edge - 1 - k : k;
+            Vec pull = points[other * points_per_edge + other_k] - p[k];
+            float distance = Length(pull);
+            if (distance > EPSILON) force = force + pull * (1.f / distance);
+          }
+          f[k] = force;
+        }
+      }
+      for (size_t e = 0; e < edge_count; e++) {
+        if (lengths[e] < EPSILON) continue;
+        for (size_t k = 1; k + 1 < points_per_edge; k++) {
+          size_t i = e * points_per_edge + k;
+          points[i] = points[i] + forces[i] * step;
+        }
+      }
+    }
+    step /= 2;
+    iterations *= 2.f / 3.f;
+  }
+
+  Result result;
+  result.points_per_edge = points_per_edge;
+  result.x.reserve(points.size());
+  result.y.reserve(points.size());
+  for (Vec point : points) {
+    result.x.push_back(point.x);
+    result.y.push_back(point.y);
+  }
+  return result;
+}
+
+};  // namespace edge_bundling
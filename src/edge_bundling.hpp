@@ -0,0 +1,47 @@
+#ifndef EDGE_BUNDLING_HPP
+#define EDGE_BUNDLING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Force-directed edge bundling (Holten and van Wijk, 2009). Every edge is
+// subdivided into a polyline whose inner points are pulled towards the
+// matching points of compatible edges, i.e. edges of similar direction,
+// length and position, while springs keep each polyline smooth. Edges that
+// run alongside each other merge into shared strokes.
+namespace edge_bundling {
+
+struct Segment {
+  float start_x, start_y;
+  float end_x, end_y;
+};
+
+struct Options {
+  int cycles = 4;          // polyline segments double every cycle, from 2
+  int iterations = 50;     // first cycle, every cycle runs 2/3 of the last
+  float step = 0.01f;      // first cycle, halved every cycle
+  float stiffness = 0.1f;  // spring constant
+  float compatibility_threshold = 0.6f;
+  // Only the most compatible edges found near an edge's midpoint attract it,
+  // which keeps the cost linear in the number of edges.
+  size_t max_partners = 32;
+  float search_radius = 4.f;
+};
+
+// Polylines of points_per_edge points each, edge i starts at
+// i * points_per_edge. Empty when the computation was cancelled.
+struct Result {
+  size_t points_per_edge = 0;
+  std::vector<float> x;
+  std::vector<float> y;
+
+  bool empty() const { return x.empty(); }
+};
+
+Result Bundle(const std::vector<Segment>& edges, const Options& options,
+              const std::atomic<bool>& cancelled);
+
+};  // namespace edge_bundling
+
+#endif  // EDGE_BUNDLING_HPP
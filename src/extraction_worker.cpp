@@ -0,0 +1,83 @@
+#include "extraction_worker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace clang_interface {
+
+void ExtractionWorker::Run(Job& job, std::string source,
+                           std::vector<std::string> compiler_args,
+                           ExtractionOptions options,
+                           std::function<void()> notify) {
+  job.ast_unit =
+      BuildASTFromSource(source, std::move(compiler_args), options);
+  if (job.ast_unit && !job.cancelled) {
+    ExtractCallGraphFromAST(
+        job.ast_unit, job.call_graph, options,
+        [&job, &notify](CallGraphBatch batch) {
+          // The queue is full when the GUI falls behind, wait for it instead
+          // of growing without bound.
+          while (!job.batches.TryPush(std::move(batch))) {
+            if (job.cancelled) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+          if (notify) notify();
+          return !job.cancelled;
+        });
+  }
+  job.finished = true;
+  if (notify) notify();
+}
+
+void ExtractionWorker::JoinFinishedJobs() {
+  auto first_finished = std::stable_partition(
+      begin(retired), end(retired),
+      [](const auto& job) { return !job->finished; });
+  std::for_each(first_finished, end(retired),
+                [](auto& job) { job->thread.join(); });
+  retired.erase(first_finished, end(retired));
+}
+
+ExtractionWorker::~ExtractionWorker() {
+  ReleasePrevious();
+  if (current) {
+    current->cancelled = true;
+    retired.push_back(std::move(current));
+  }
+  for (auto& job : retired) {
+    job->cancelled = true;
+    job->thread.join();
+  }
+}
+
+void ExtractionWorker::Start(std::string source,
+                             std::vector<std::string> compiler_args,
+                             ExtractionOptions options) {
+  if (current) {
+    current->cancelled = true;
+    previous.push_back(std::move(current));
+  }
+  JoinFinishedJobs();
+
+  current = std::make_unique<Job>();
+  current->thread = std::thread(Run, std::ref(*current), std::move(source),
+                                std::move(compiler_args), std::move(options),
+                                notify);
+}
+
+void ExtractionWorker::ReleasePrevious() {
+  std::move(begin(previous), end(previous), std::back_inserter(retired));
+  previous.clear();
+}
+
+bool ExtractionWorker::TryPopBatch(CallGraphBatch& batch) {
+  JoinFinishedJobs();
+  return current && current->batches.TryPop(batch);
+}
+
+bool ExtractionWorker::IsExtracting() const {
+  return current && !(current->finished && current->batches.Empty());
+}
+
+};  // namespace clang_interface
@@ -0,0 +1,74 @@
+#ifndef EXTRACTION_WORKER_HPP
+#define EXTRACTION_WORKER_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "clang_interface.h"
+#include "spsc_queue.hpp"
+
+namespace clang_interface {
+
+// Parses and extracts the call graph on a background thread. Extracted nodes
+// and edges are published in batches, the GUI thread pops them with
+// TryPopBatch and merges them at its own pace.
+//
+// The AST and CallGraph of the last started extraction stay alive until the
+// next Start, so FunctionDecl pointers handed out in batches remain valid
+// until then. Starting a new extraction cancels the running one; its thread
+// is joined once it notices the cancellation.
+//
+// Extractions replaced by Start are kept until ReleasePrevious, so views can
+// go on showing the old graph while the new one streams in and diff the two
+// once it is complete.
+//
+// The optional notify callback is invoked from the worker thread whenever a
+// batch was queued and when an extraction finishes, so an idle GUI can wake
+// up instead of polling.
+class ExtractionWorker {
+ private:
+  static constexpr size_t BATCH_QUEUE_CAPACITY = 64;
+
+  struct Job {
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> finished{false};
+    SPSCQueue<CallGraphBatch, BATCH_QUEUE_CAPACITY> batches;
+    ASTUnit ast_unit;
+    CallGraph call_graph;
+    std::thread thread;
+  };
+
+  std::function<void()> notify;
+  std::unique_ptr<Job> current;
+  std::vector<std::unique_ptr<Job>> previous;
+  std::vector<std::unique_ptr<Job>> retired;
+
+  static void Run(Job& job, std::string source,
+                  std::vector<std::string> compiler_args,
+                  ExtractionOptions options, std::function<void()> notify);
+  void JoinFinishedJobs();
+
+ public:
+  ExtractionWorker() = default;
+  explicit ExtractionWorker(std::function<void()> notify)
+      : notify(std::move(notify)) {}
+  ExtractionWorker(const ExtractionWorker&) = delete;
+  ExtractionWorker& operator=(const ExtractionWorker&) = delete;
+  ~ExtractionWorker();
+
+  void Start(std::string source, std::vector<std::string> compiler_args,
+             ExtractionOptions options);
+  // Lets go of the extractions replaced by Start, their FunctionDecl
+  // pointers must no longer be referenced.
+  void ReleasePrevious();
+  bool TryPopBatch(CallGraphBatch& batch);
+  // True until every batch of the current extraction has been popped.
+  bool IsExtracting() const;
+};
+
+};  // namespace clang_interface
+
+#endif  // EXTRACTION_WORKER_HPP
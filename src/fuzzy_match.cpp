@@ -0,0 +1,73 @@
+#include "fuzzy_match.hpp"
+
+namespace fuzzy_match {
+
+namespace {
+
+constexpr int SCORE_MATCH = 16;
+constexpr int BONUS_BOUNDARY = 8;
+constexpr int BONUS_CONSECUTIVE = 4;
+constexpr int BONUS_FIRST_CHAR = 8;
+constexpr int PENALTY_GAP_START = 3;
+constexpr int PENALTY_GAP_EXTENSION = 1;
+
+char ToLower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+bool IsLower(char c) { return c >= 'a' && c <= 'z'; }
+bool IsUpper(char c) { return c >= 'A' && c <= 'Z'; }
+bool IsWordChar(char c) {
+  return IsLower(c) || IsUpper(c) || (c >= '0' && c <= '9');
+}
+
+bool IsBoundary(std::string_view text, size_t i) {
+  if (i == 0) return true;
+  char previous = text[i - 1];
+  return !IsWordChar(previous) || (IsLower(previous) && IsUpper(text[i]));
+}
+
+}  // namespace
+
+int Score(std::string_view pattern, std::string_view text) {
+  if (pattern.empty()) return 0;
+  if (pattern.size() > text.size()) return NO_MATCH;
+
+  // Find where the first left to right match ends, then walk back from there
+  // to the latest start that still matches, which gives the shortest window
+  // ending at that position.
+  size_t p = 0;
+  size_t end = 0;
+  for (; end < text.size(); end++) {
+    if (ToLower(text[end]) == ToLower(pattern[p]) && ++p == pattern.size())
+      break;
+  }
+  if (p < pattern.size()) return NO_MATCH;
+  size_t start = end;
+  for (p = pattern.size(); p-- > 0; start--) {
+    while (ToLower(text[start]) != ToLower(pattern[p])) start--;
+    if (p == 0) break;
+  }
+
+  int score = 0;
+  bool in_gap = false;
+  bool previous_matched = false;
+  p = 0;
+  for (size_t i = start; i <= end; i++) {
+    if (p < pattern.size() && ToLower(text[i]) == ToLower(pattern[p])) {
+      score += SCORE_MATCH;
+      if (IsBoundary(text, i)) {
+        score += p == 0 ? BONUS_BOUNDARY + BONUS_FIRST_CHAR : BONUS_BOUNDARY;
+      }
+      if (previous_matched) score += BONUS_CONSECUTIVE;
+      previous_matched = true;
+      in_gap = false;
+      p++;
+    } else {
+      score -= in_gap ? PENALTY_GAP_EXTENSION : PENALTY_GAP_START;
+      previous_matched = false;
+      in_gap = true;
+    }
+  }
+  // Between otherwise equal matches the one starting earlier wins.
+  return score - static_cast<int>(start);
+}
+
+};  // namespace fuzzy_match
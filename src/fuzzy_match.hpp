@@ -0,0 +1,25 @@
+#ifndef FUZZY_MATCH_HPP
+#define FUZZY_MATCH_HPP
+
+#include <climits>
+#include <string_view>
+
+// Subsequence matching as used by "go to symbol" pickers. Every character of
+// the pattern has to appear in the text in order, case insensitively. The
+// score rewards matches at word starts (after '_', ':', punctuation or at a
+// camelCase hump) and runs of consecutive matches, and penalizes the gaps
+// between them, so "gnn" ranks get_node_name above a long unrelated name
+// that merely contains the letters.
+namespace fuzzy_match {
+
+constexpr int NO_MATCH = INT_MIN;
+
+// Score of the first match found scanning text left to right, narrowed to
+// the shortest window ending where that scan completes. Not necessarily the
+// best scoring alignment. NO_MATCH when the pattern is not a subsequence of
+// text, an empty pattern matches everything with 0.
+int Score(std::string_view pattern, std::string_view text);
+
+};  // namespace fuzzy_match
+
+#endif  // FUZZY_MATCH_HPP
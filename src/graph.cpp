@@ -1,161 +1,484 @@
 #include "graph.hpp"
 
-#include <set>
+#include <chrono>
+#include "gui.hpp"
 #include "keyboard.hpp"
+#include "string_pool.hpp"
 
 namespace gui {
 
-Node::Node() { init(); }
+NodeId NodeStore::add(clang_interface::FunctionDecl* node_function,
+                      std::string_view node_group) {
+  layout_x.push_back(0);
+  layout_y.push_back(0);
+  active_parents.push_back(0);
+  show_children.push_back(false);
+  depth.push_back(0);
+  function.push_back(node_function);
+  group.push_back(node_group);
+  functions.push_back(1);
+  neighbors.emplace_back();
+  calls.emplace_back();
+  return function.size() - 1;
+}
 
-Node::Node(clang_interface::FunctionDecl* _function) : function(_function) {
-  init();
+void NodeStore::compact(const std::vector<NodeId>& remap, size_t count) {
+  auto compact_field = [&remap, count](auto& field) {
+    for (NodeId node = 0; node < remap.size(); node++) {
+      if (remap[node] != NO_NODE) field[remap[node]] = field[node];
+    }
+    field.resize(count);
+  };
+  compact_field(layout_x);
+  compact_field(layout_y);
+  compact_field(active_parents);
+  compact_field(show_children);
+  compact_field(depth);
+  compact_field(function);
+  compact_field(group);
+  compact_field(functions);
+  compact_field(neighbors);
+  compact_field(calls);
 }
 
-void Node::init() {
-  position = current_node_size;
-  size = current_node_size;
-  number_of_active_parents = 0;
-  depth = 0;
-  show_children = false;
+void NodeStore::clear() {
+  layout_x.clear();
+  layout_y.clear();
+  active_parents.clear();
+  show_children.clear();
+  depth.clear();
+  function.clear();
+  group.clear();
+  functions.clear();
+  neighbors.clear();
+  calls.clear();
 }
 
-void Node::set_display_name() {
-  const char* name = function->NameAsString().c_str();
-  unsigned name_length = std::min(10u, (unsigned)strlen(name));
-  int k = 0;
-  while (k < name_length) {
-    display_name[k] = name[k];
-    k++;
+void GraphGui::show_neighbours(NodeId node) {
+  view_changed();
+  nodes.show_children[node] = true;
+  for (NodeId neighbor : nodes.neighbors[node]) {
+    nodes.active_parents[neighbor]++;
   }
-  display_name[k] = '\0';
 }
 
-void Node::show_neighbours() {
-  show_children = true;
-  for (unsigned i = 0; i < neighbors.size(); i++) {
-    Node* neighbor = neighbors.at(i);
-    neighbor->number_of_active_parents++;
+// Neighbors left without active parents hide their own neighbors in turn.
+// Runs on an explicit stack, call chains can be deeper than the C++ one.
+void GraphGui::hide_neighbours(NodeId node) {
+  view_changed();
+  nodes.show_children[node] = false;
+  traversal.clear();
+  traversal.push_back(node);
+  while (!traversal.empty()) {
+    NodeId current = traversal.back();
+    traversal.pop_back();
+    for (NodeId neighbor : nodes.neighbors[current]) {
+      if (nodes.active_parents[neighbor] > 0) nodes.active_parents[neighbor]--;
+      if (nodes.active_parents[neighbor] == 0 &&
+          nodes.show_children[neighbor]) {
+        nodes.show_children[neighbor] = false;
+        traversal.push_back(neighbor);
+      }
+    }
   }
 }
 
-void Node::hide_neighbours() {
-  show_children = false;
-  for (unsigned i = 0; i < neighbors.size(); i++) {
-    Node* neighbor = neighbors.at(i);
-    if (neighbor->number_of_active_parents > 0)
-      neighbor->number_of_active_parents--;
-    if (neighbor->number_of_active_parents == 0 && neighbor->show_children)
-      neighbor->hide_neighbours();
+// Starts a traversal with no node visited. The scratch arrays only grow,
+// so traversals allocate nothing once they have seen the whole graph.
+void GraphGui::begin_traversal() {
+  if (visit_mark.size() < nodes.size()) {
+    visit_mark.resize(nodes.size(), 0);
+    predecessor.resize(nodes.size(), NO_NODE);
+  }
+  if (++visit_epoch == 0) {
+    std::fill(visit_mark.begin(), visit_mark.end(), 0);
+    visit_epoch = 1;
   }
+  traversal.clear();
 }
 
-void Node::draw(ImGuiWindow* window, const ImU32& line_color,
-                size_t line_thickness) {
-  if (number_of_active_parents == 0) return;
-
-  ImVec2 real_position = ImVec2(position.x + scroll_x, position.y + scroll_y);
+// Marks node visited, false when it already was in this traversal.
+bool GraphGui::visit(NodeId node) {
+  if (visit_mark[node] == visit_epoch) return false;
+  visit_mark[node] = visit_epoch;
+  return true;
+}
 
-  ImGui::SetNextWindowPos(real_position);
-  ImGui::SetNextWindowSize(size);
-  ImGui::BeginChild(std::to_string(function->ID()).c_str(), size, false);
+// The minimap and the edge bundles of the previous layout or set of visible
+// nodes are stale.
+void GraphGui::view_changed() {
+  minimap_dirty = true;
+  layout_generation++;
+  cancel_bundling();
+}
 
-  ImVec2 position = ImVec2(real_position.x + current_node_size.x / 2,
-                           real_position.y + current_node_size.y / 2);
+void GraphGui::layout() {
+  view_changed();
+  layers.clear();
+  layers.resize(nodes.size(), 0);
+  auto place = [this](NodeId node) {
+    nodes.layout_x[node] = nodes.depth[node];
+    nodes.layout_y[node] = layers.at(nodes.depth[node])++;
+  };
+  if (root != NO_NODE) place(root);
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    if (node != root) place(node);
+  }
+}
 
-  float node_radius = current_node_size.x / 2;
+// Maps layout positions to screen positions, marks the visible nodes that
+// overlap the window and finds the node under the mouse.
+void GraphGui::transform_nodes() {
+  size_t count = nodes.size();
+  screen_x.resize(count);
+  screen_y.resize(count);
+  on_screen.resize(count);
+
+  node_kernels::FrameParams params;
+  params.scale_x = node_distance_x;
+  params.scale_y = node_distance_y;
+  params.offset_x = window->Pos.x + camera.translation.x;
+  params.offset_y = window->Pos.y + camera.translation.y;
+  params.min_x = window->Pos.x - current_node_size.x;
+  params.min_y = window->Pos.y - current_node_size.y;
+  params.max_x = window->Pos.x + window->Size.x;
+  params.max_y = window->Pos.y + window->Size.y;
+  params.hit_test =
+      ImGui::IsWindowHovered() &&
+      !(show_minimap && minimap_rect.Contains(io_pointer->MousePos));
+  params.hit_radius = current_node_size.x / 2;
+  params.hit_x = io_pointer->MousePos.x - params.hit_radius;
+  params.hit_y = io_pointer->MousePos.y - current_node_size.y / 2;
+
+  node_kernels::NodeInput input = {nodes.layout_x.data(),
+                                   nodes.layout_y.data(),
+                                   nodes.active_parents.data(), count};
+  node_kernels::NodeOutput output = {screen_x.data(), screen_y.data(),
+                                     on_screen.data()};
+  size_t hit = node_kernels::TransformCullHitTest(input, params, output);
+  hovered_node = hit == node_kernels::NO_HIT ? NO_NODE : hit;
+}
 
-  window->DrawList->AddCircleFilled(position, node_radius, col32Node, 256);
-  window->DrawList->AddText(ImVec2(position.x - current_node_size.x / 2,
-                                   position.y + node_radius + 5.f),
-                            col32Text, display_name);
+DetailLevel GraphGui::detail_level() const {
+  if (current_node_size.x < LOD_POINT_MAX_SIZE) return DetailLevel::Points;
+  if (current_node_size.x < LOD_LABEL_MIN_SIZE) return DetailLevel::Shapes;
+  return DetailLevel::Full;
+}
 
-  ImGuiWindow* node_window = ImGui::GetCurrentWindow();
+void GraphGui::draw_node(NodeId node) {
+  float node_radius = current_node_size.x / 2;
+  ImVec2 position = ImVec2(screen_x[node] + node_radius,
+                           screen_y[node] + current_node_size.y / 2);
+
+  if (node_radius < LOD_POINT_RADIUS) node_radius = LOD_POINT_RADIUS;
+  if (renderer.Available())
+    renderer.AddNode(position, node_radius, col32Node);
+  else
+    window->DrawList->AddCircleFilled(position, node_radius, col32Node,
+                                      node_radius < 8 ? 8 : 256);
+}
 
-  bool is_clicked = ImGui::IsMouseClicked(0);
-  bool is_hovering = ImGui::IsWindowHovered();
+void GraphGui::draw_label(NodeId node) {
+  ImVec2 position = ImVec2(screen_x[node],
+                           screen_y[node] + current_node_size.y / 2 +
+                               current_node_size.x / 2 + 5.f);
+  std::string_view label = nodes.group[node].empty()
+                               ? nodes.function[node]->NameAsString()
+                               : nodes.group[node];
+  labels.Draw(window->DrawList, node, label, position, col32Text);
+}
 
-  if (is_hovering) hovered_node = this;
+void GraphGui::draw_edge(ImVec2 start_position, ImVec2 end_position,
+                         size_t edge, unsigned calls, bool arrow) {
+  // Edges between groups get thicker with the number of calls they sum up
+  float thickness = node_line_thickness *
+                    std::min(1 + std::log2(static_cast<float>(calls)) / 2, 4.f);
+  if (has_bundles() && bundle_index[edge] != NO_BUNDLE) {
+    // Interior points come from the bundles, the ends stay on the nodes
+    size_t count = bundles.points_per_edge;
+    const float* x = &bundles.x[bundle_index[edge] * count];
+    const float* y = &bundles.y[bundle_index[edge] * count];
+    float origin_x = window->Pos.x + camera.translation.x;
+    float origin_y = window->Pos.y + camera.translation.y;
+    polyline.resize(count);
+    polyline.front() = start_position;
+    for (size_t k = 1; k + 1 < count; k++)
+      polyline[k] = ImVec2(origin_x + x[k] * node_distance_x,
+                           origin_y + y[k] * node_distance_y);
+    polyline.back() = end_position;
+    if (renderer.Available())
+      renderer.AddPolyline(polyline.data(), count, thickness,
+                           node_line_color);
+    else
+      window->DrawList->AddPolyline(polyline.data(), count, node_line_color,
+                                    false, thickness);
+  } else {
+    ImVec2 control_start =
+        ImVec2(start_position.x + current_node_size.x / 2, start_position.y);
+    ImVec2 control_end = ImVec2(start_position.x, end_position.y);
+    if (renderer.Available())
+      renderer.AddEdge(start_position, control_start, control_end,
+                       end_position, thickness, node_line_color);
+    else
+      window->DrawList->AddBezierCurve(start_position, control_start,
+                                       control_end, end_position,
+                                       node_line_color, thickness);
+  }
+  if (arrow) draw_arrow(start_position, end_position);
+}
 
-  if (is_clicked && is_hovering) last_clicked_node = this;
+void GraphGui::draw_arrow(ImVec2 start_position, ImVec2 end_position) {
+  // Arrow at the end when the edge goes right, at the start otherwise
+  bool forward = start_position.x + current_node_size.x / 2 <= end_position.x;
 
-  if (number_of_active_parents && is_clicked && is_hovering) {
-    if (show_children)
-      hide_neighbours();
+  if (renderer.Available()) {
+    if (forward)
+      renderer.AddArrow(ImVec2(end_position.x + 10.f, end_position.y), 1.f,
+                        node_line_color);
     else
-      show_neighbours();
+      renderer.AddArrow(ImVec2(start_position.x - 10.f, start_position.y),
+                        -1.f, node_line_color);
+    return;
+  }
+
+  // Drawing triangles for arrow end
+  if (forward)
+    window->DrawList->AddTriangleFilled(
+        ImVec2(end_position.x + 10.f, end_position.y),
+        ImVec2(end_position.x, end_position.y + 5.f),
+        ImVec2(end_position.x, end_position.y - 5.f), node_line_color);
+  else {
+    window->DrawList->AddTriangleFilled(
+        ImVec2(start_position.x - 10.f, start_position.y),
+        ImVec2(start_position.x, start_position.y + 5.f),
+        ImVec2(start_position.x, start_position.y - 5.f), node_line_color);
   }
+}
+
+void GraphGui::draw_edges(DetailLevel detail) {
+  float min_x = window->Pos.x, max_x = window->Pos.x + window->Size.x;
+  float min_y = window->Pos.y, max_y = window->Pos.y + window->Size.y;
+
+  size_t edge = 0;
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    size_t first_edge = edge;
+    edge += nodes.neighbors[node].size();
+    if (!nodes.active_parents[node] || !nodes.show_children[node]) continue;
 
-  if (show_children) {
-    ImVec2 start_position = node_window->Pos;
+    ImVec2 start_position = ImVec2(screen_x[node], screen_y[node]);
     start_position.x += current_node_size.x - 5;
     start_position.y += current_node_size.y / 2;
 
-    for (unsigned i = 0; i < neighbors.size(); i++) {
-      Node* neighbor = neighbors.at(i);
-      if (!neighbor->number_of_active_parents) continue;
+    for (size_t k = 0; k < nodes.neighbors[node].size(); k++) {
+      NodeId neighbor = nodes.neighbors[node][k];
+      if (!nodes.active_parents[neighbor]) continue;
 
-      ImVec2 end_position = ImVec2(neighbor->position.x + scroll_x,
-                                   neighbor->position.y + scroll_y);
+      ImVec2 end_position = ImVec2(screen_x[neighbor], screen_y[neighbor]);
       end_position.x += 5;
       end_position.y += current_node_size.y / 2;
 
-      window->DrawList->AddBezierCurve(
-          start_position,
-          ImVec2(start_position.x + current_node_size.x / 2, start_position.y),
-          ImVec2(start_position.x, end_position.y), end_position, line_color,
-          line_thickness);
-      // Drawing triangles for arrow end
-      if (start_position.x + current_node_size.x / 2 <= end_position.x)
-        window->DrawList->AddTriangleFilled(
-            ImVec2(end_position.x + 10.f, end_position.y),
-            ImVec2(end_position.x, end_position.y + 5.f),
-            ImVec2(end_position.x, end_position.y - 5.f), line_color);
-      else {
-        window->DrawList->AddTriangleFilled(
-            ImVec2(start_position.x - 10.f, start_position.y),
-            ImVec2(start_position.x, start_position.y + 5.f),
-            ImVec2(start_position.x, start_position.y - 5.f), line_color);
+      // Skip edges whose bounding box misses the window
+      if ((start_position.x < min_x && end_position.x < min_x) ||
+          (start_position.x > max_x && end_position.x > max_x) ||
+          (start_position.y < min_y && end_position.y < min_y) ||
+          (start_position.y > max_y && end_position.y > max_y))
+        continue;
+
+      draw_edge(start_position, end_position, first_edge + k,
+                nodes.calls[node][k], detail == DetailLevel::Full);
+    }
+  }
+}
+
+// Zoomed far out individual edges are sub-pixel apart, so edges are counted
+// per (start cell, end cell) pair and each pair is drawn as one straight
+// stroke, thicker and more opaque the more edges it stands for.
+void GraphGui::draw_edge_bundles() {
+  auto cell = [](float position) -> uint64_t {
+    float index = std::floor(position / EDGE_BUNDLE_CELL);
+    return static_cast<uint16_t>(
+        static_cast<int16_t>(std::max(-32768.f, std::min(32767.f, index))));
+  };
+  auto cell_center = [](uint64_t key, int shift) {
+    auto index = static_cast<int16_t>((key >> shift) & 0xffff);
+    return (index + 0.5f) * EDGE_BUNDLE_CELL;
+  };
+  float min_x = window->Pos.x, max_x = window->Pos.x + window->Size.x;
+  float min_y = window->Pos.y, max_y = window->Pos.y + window->Size.y;
+  float node_offset = current_node_size.x / 2;
+
+  edge_bundles.clear();
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    if (!nodes.active_parents[node] || !nodes.show_children[node]) continue;
+    float start_x = screen_x[node] + node_offset;
+    float start_y = screen_y[node] + node_offset;
+    for (NodeId neighbor : nodes.neighbors[node]) {
+      if (!nodes.active_parents[neighbor]) continue;
+      float end_x = screen_x[neighbor] + node_offset;
+      float end_y = screen_y[neighbor] + node_offset;
+      if ((start_x < min_x && end_x < min_x) ||
+          (start_x > max_x && end_x > max_x) ||
+          (start_y < min_y && end_y < min_y) ||
+          (start_y > max_y && end_y > max_y))
+        continue;
+      uint64_t key = cell(start_x) << 48 | cell(start_y) << 32 |
+                     cell(end_x) << 16 | cell(end_y);
+      edge_bundles[key]++;
+    }
+  }
+
+  for (const auto [key, count] : edge_bundles) {
+    ImVec2 start(cell_center(key, 48), cell_center(key, 32));
+    ImVec2 end(cell_center(key, 16), cell_center(key, 0));
+    float weight = std::log2(1.f + count);
+    float thickness = std::min(1.f + weight, 6.f);
+    auto alpha = static_cast<unsigned>(std::min(60.f + 40.f * weight, 255.f));
+    ImU32 color = (node_line_color & ~IM_COL32_A_MASK) |
+                  (alpha << IM_COL32_A_SHIFT);
+    if (renderer.Available())
+      renderer.AddEdge(start, start, end, end, thickness, color);
+    else
+      window->DrawList->AddLine(start, end, color, thickness);
+  }
+}
+
+GraphGui::~GraphGui() { cancel_bundling(); }
+
+bool GraphGui::has_bundles() const {
+  return bundle_edges && bundles_generation == layout_generation &&
+         !bundles.empty();
+}
+
+bool GraphGui::bundles_ready() const {
+  return bundling_job.valid() &&
+         bundling_job.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready;
+}
+
+void GraphGui::cancel_bundling() {
+  if (bundling_cancelled) *bundling_cancelled = true;
+}
+
+// Collects a finished bundling job and starts a new one when the layout or
+// the visible nodes changed since the last. A job started for an older view
+// was cancelled and its result is dropped.
+void GraphGui::update_bundles() {
+  if (bundles_ready()) {
+    auto result = bundling_job.get();
+    if (bundling_job_generation == layout_generation) {
+      bundles = std::move(result);
+      bundle_index.swap(job_bundle_index);
+      bundles_generation = layout_generation;
+    }
+  }
+  if (!bundle_edges || bundling_job.valid() ||
+      bundles_generation == layout_generation || edge_count == 0)
+    return;
+
+  // Only the edges draw_edges shows are bundled, hidden ones would pull
+  // the visible edges towards strokes that are not drawn. Node borders in
+  // layout units, a node is 1 / 1.5 of a grid cell wide.
+  const float node_extent = 1 / 1.5f;
+  std::vector<edge_bundling::Segment> segments;
+  job_bundle_index.assign(edge_count, NO_BUNDLE);
+  size_t edge = 0;
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    bool expanded = nodes.active_parents[node] && nodes.show_children[node];
+    for (NodeId neighbor : nodes.neighbors[node]) {
+      if (expanded && nodes.active_parents[neighbor]) {
+        job_bundle_index[edge] = segments.size();
+        segments.push_back({nodes.layout_x[node] + node_extent,
+                            nodes.layout_y[node] + node_extent / 2,
+                            nodes.layout_x[neighbor],
+                            nodes.layout_y[neighbor] + node_extent / 2});
       }
+      edge++;
     }
   }
-  ImGui::End();
-  if (ImGui::IsWindowFocused()) refresh_nodes = true;
+  if (segments.empty() || segments.size() > MAX_BUNDLED_EDGES) {
+    // Nothing to bundle for this view, edges are drawn as curves
+    bundles = edge_bundling::Result();
+    bundles_generation = layout_generation;
+    return;
+  }
+
+  bundling_cancelled = std::make_shared<std::atomic<bool>>(false);
+  bundling_job_generation = layout_generation;
+  bundling_job = std::async(
+      std::launch::async,
+      [segments = std::move(segments), cancelled = bundling_cancelled] {
+        auto result = edge_bundling::Bundle(segments, {}, *cancelled);
+        MainWindow::Wake();
+        return result;
+      });
 }
 
 void GraphGui::set_window(ImGuiWindow* new_window) { window = new_window; }
 
+void GraphGui::init_renderer(const char* glsl_version) {
+  if (!renderer.Init(glsl_version))
+    fprintf(stderr, "Instanced graph rendering unavailable, using ImGui\n");
+}
+
 void GraphGui::draw(clang_interface::FunctionDecl* function) {
   ImGui::Begin(
-      "Generated Callgraph", &p_show,
+      title.c_str(), &p_show,
       ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoBringToFrontOnFocus);
   if (ImGui::IsWindowHovered() && !ImGui::IsWindowFocused())
     ImGui::SetWindowFocus();
 
   set_window(ImGui::GetCurrentWindow());
 
-  key_input_check();
-  hovered_node = nullptr;
-  layers.clear();
-  layers.resize(nodes.size(), 0);
-
-  for (auto& node : nodes) {
-    node->set_position(
-        ImVec2(left_distance + window->Pos.x + node->depth * node_distance_x,
-               top_distance + window->Pos.y +
-                   layers.at(node->depth) * node_distance_y));
-    layers.at(node->depth)++;
-  }
-
-  for (auto& node : nodes) {
-    if (node->function == function && root != node.get()) {
-      root = node.get();
+  if (function != nullptr && root != NO_NODE && function != requested_root) {
+    auto selected = node_by_id.find(function->ID());
+    if (selected != node_by_id.end()) {
+      requested_root = function;
+      root = selected->second;
+      root_selected = true;
       graph_init();
     }
+  }
 
-    node->draw(window, node_line_color, node_line_thickness);
+  minimap_rect.Min =
+      ImVec2(window->Pos.x + window->Size.x - MINIMAP_SIZE.x - 10,
+             window->Pos.y + 50);
+  minimap_rect.Max = ImVec2(minimap_rect.Min.x + MINIMAP_SIZE.x,
+                           minimap_rect.Min.y + MINIMAP_SIZE.y);
+
+  key_input_check();
+  update_camera();
+  transform_nodes();
+  update_bundles();
+  renderer.Clear();
+
+  if (hovered_node != NO_NODE && ImGui::IsMouseClicked(0) &&
+      !ImGui::IsAnyItemHovered()) {
+    last_clicked_node = hovered_node;
+    if (nodes.show_children[hovered_node])
+      hide_neighbours(hovered_node);
+    else
+      show_neighbours(hovered_node);
   }
 
-  if (refresh_nodes) refresh();
+  DetailLevel detail = detail_level();
+  if (detail == DetailLevel::Points)
+    draw_edge_bundles();
+  else
+    draw_edges(detail);
+
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    if (on_screen[node]) draw_node(node);
+  }
+  // Labels go on top of the instanced shapes, so after the callback
+  if (renderer.Available()) renderer.Submit(window->DrawList);
+  if (detail == DetailLevel::Full) {
+    // Labels may use the gap up to the next column
+    labels.Prepare(ImGui::GetFont(), ImGui::GetFontSize(),
+                   node_distance_x - 5.f);
+    for (NodeId node = 0; node < nodes.size(); node++) {
+      if (on_screen[node]) draw_label(node);
+    }
+  }
 
   draw_node_info_window();
   ImGui::SetCursorScreenPos(ImVec2(window->Pos.x + 5, window->Pos.y + 25));
@@ -171,33 +494,38 @@ void GraphGui::draw(clang_interface::FunctionDecl* function) {
 	  shrink_graph();
       }
   }
+  ImGui::SameLine();
+  ImGui::Checkbox("Bundle edges", &bundle_edges);
+  ImGui::SameLine();
+  ImGui::Checkbox("Minimap", &show_minimap);
+  ImGui::SameLine();
+  int level = static_cast<int>(aggregation);
+  ImGui::SetNextItemWidth(120);
+  if (ImGui::Combo("Nodes", &level, aggregation::LEVEL_NAMES,
+                   aggregation::LEVEL_COUNT)) {
+    aggregation = static_cast<aggregation::Level>(level);
+    aggregation_changed = true;
+  }
+  if (show_minimap && !nodes.empty()) draw_minimap();
   ImGui::End();
 }
 
-void GraphGui::calculate_depth(Node* node) {
-  std::set<unsigned> visited;
-
-  std::queue<std::pair<Node*, int> > s;
-  s.push(std::make_pair(node, 0));
-  while (!s.empty()) {
-    Node* node = s.front().first;
-    int depth = s.front().second;
-    s.pop();
-
-    if (visited.insert(node->function->ID()).second == false) continue;
-
-    node->set_depth(depth);
-    for (Node* neighbor : node->neighbors)
-      s.push(std::make_pair(neighbor, depth + 1));
+void GraphGui::calculate_depth(NodeId node) {
+  // Breadth first, traversal doubles as the queue
+  begin_traversal();
+  visit(node);
+  nodes.depth[node] = 0;
+  traversal.push_back(node);
+  for (size_t head = 0; head < traversal.size(); head++) {
+    NodeId current = traversal[head];
+    for (NodeId neighbor : nodes.neighbors[current]) {
+      if (!visit(neighbor)) continue;
+      nodes.depth[neighbor] = nodes.depth[current] + 1;
+      traversal.push_back(neighbor);
+    }
   }
 }
 
-void GraphGui::refresh() {
-  for (auto& node : nodes)
-    ImGui::SetWindowFocus(node->function->NameAsString().c_str());
-  refresh_nodes = false;
-}
-
 void GraphGui::key_input_check() {
   ImVec2 screen_position = io_pointer->MousePos;
 
@@ -209,130 +537,456 @@ void GraphGui::key_input_check() {
 
   if (io_pointer->KeysDown[keyboard::WKey] ||
       io_pointer->KeysDown[io_pointer->KeyMap[ImGuiKey_UpArrow]]) {
-    scroll_y -= SCROLL_SPEED;
+    camera.translation.y -= SCROLL_SPEED;
   }
   if (io_pointer->KeysDown[keyboard::SKey] ||
       io_pointer->KeysDown[io_pointer->KeyMap[ImGuiKey_DownArrow]]) {
-    scroll_y += SCROLL_SPEED;
+    camera.translation.y += SCROLL_SPEED;
   }
   if (io_pointer->KeysDown[keyboard::AKey] ||
       io_pointer->KeysDown[io_pointer->KeyMap[ImGuiKey_LeftArrow]]) {
-    scroll_x -= SCROLL_SPEED;
+    camera.translation.x -= SCROLL_SPEED;
   }
   if (io_pointer->KeysDown[keyboard::DKey] ||
       io_pointer->KeysDown[io_pointer->KeyMap[ImGuiKey_RightArrow]]) {
-    scroll_x += SCROLL_SPEED;
+    camera.translation.x += SCROLL_SPEED;
   }
 
-  if ((hovered_node != nullptr) && io_pointer->KeyShift &&
+  if ((hovered_node != NO_NODE) && io_pointer->KeyShift &&
       io_pointer->KeyCtrl && io_pointer->KeysDown[keyboard::TKey]) {
     
-    auto row = hovered_node->function->FullSourceLoc().getLineNumber();
-	editor_pointer->SetSelection(
-          TextEditor::Coordinates(row - 1, 0),
-          TextEditor::Coordinates(
-              row, 0));
-	editor_pointer->SetCursorPosition(TextEditor::Coordinates(row-1,0));
-    hovered_node = nullptr;
-  }
-
-  current_node_size.x *=
-      (100.0f - ZOOM_SPEED * io_pointer->MouseWheel) / 100.0f;
-  current_node_size.y *=
-      (100.0f - ZOOM_SPEED * io_pointer->MouseWheel) / 100.0f;
-  current_node_size.x = std::max(NODE_MIN_SIZE_X, current_node_size.x);
-  current_node_size.y = std::max(NODE_MIN_SIZE_Y, current_node_size.y);
-  node_distance_x = 1.5 * current_node_size.x;
-  node_distance_y = 1.5 * current_node_size.y;
-  for (auto& node : nodes) node->set_size(current_node_size);
+    show_in_editor(hovered_node);
+    hovered_node = NO_NODE;
+  }
+
+  if (io_pointer->MouseWheel != 0) {
+    camera.zoom(
+        std::pow((100.0f - ZOOM_SPEED) / 100.0f, io_pointer->MouseWheel),
+        ImVec2(screen_position.x - window->Pos.x,
+               screen_position.y - window->Pos.y));
+  }
 }
 
-void GraphGui::focus_node(const std::string& node_signature) {
-  for (const auto& e : nodes)
-    if (e->function->NameAsString() == node_signature) {
-      if (e->number_of_active_parents <= 0) continue;
+void Camera::zoom(float factor, ImVec2 anchor) {
+  target_scale = std::clamp(target_scale * factor,
+                            NODE_MIN_SIZE_X / NODE_DEFAULT_SIZE,
+                            NODE_MAX_SIZE_Y / NODE_DEFAULT_SIZE);
+  zoom_anchor = anchor;
+}
 
-      int wx = window->Pos.x;
-      int wy = window->Pos.y;
-      int wx_mid = window->Size.x / 2;
-      int wy_mid = window->Size.y / 2;
+void Camera::update(float delta_time) {
+  if (!animating()) return;
+  // After idling the first frame's delta covers the whole idle time
+  delta_time = std::min(delta_time, 1 / 30.f);
+  float new_scale =
+      target_scale +
+      (scale - target_scale) * std::exp(-ZOOM_SMOOTHING * delta_time);
+  if (std::abs(new_scale - target_scale) < target_scale * 1e-3f)
+    new_scale = target_scale;
+  // Keep the world point under the anchor where it is
+  float ratio = new_scale / scale;
+  translation.x = zoom_anchor.x - (zoom_anchor.x - translation.x) * ratio;
+  translation.y = zoom_anchor.y - (zoom_anchor.y - translation.y) * ratio;
+  scale = new_scale;
+}
 
-      int x = e->position.x - wx;
-      int y = e->position.y - wy;
+void GraphGui::update_camera() {
+  camera.update(io_pointer->DeltaTime);
+  current_node_size = ImVec2(NODE_DEFAULT_SIZE * camera.scale,
+                             NODE_DEFAULT_SIZE * camera.scale);
+  node_distance_x = NODE_SPACING * camera.scale;
+  node_distance_y = NODE_SPACING * camera.scale;
+}
 
-      scroll_x = wx_mid - x - e->size.x / 2;
-      scroll_y = wy_mid - y - e->size.x / 2;
+void GraphGui::index_names(const clang_interface::FunctionDecl* function,
+                           NodeId node) {
+  node_by_name.emplace(function->SignatureAsString(),
+                       NameMatch{node, NameMatch::Signature});
+  node_by_name.emplace(function->QualifiedNameAsString(),
+                       NameMatch{node, NameMatch::QualifiedName});
+  if (function->NameAsString() != function->QualifiedNameAsString()) {
+    node_by_name.emplace(function->NameAsString(),
+                         NameMatch{node, NameMatch::Name});
+  }
+}
 
-      break;
+void GraphGui::focus_node(const std::string& node_signature) {
+  // The most exact match wins, visible nodes win among equally exact ones
+  NodeId best = NO_NODE;
+  int best_rank = -1;
+  auto [first, last] = node_by_name.equal_range(node_signature);
+  for (auto match = first; match != last; ++match) {
+    NodeId node = match->second.node;
+    int rank = 2 * match->second.rank + (nodes.active_parents[node] > 0);
+    if (rank > best_rank) {
+      best = node;
+      best_rank = rank;
     }
+  }
+  if (best == NO_NODE) return;
+  reveal_node(best);
+  center_view(nodes.layout_x[best], nodes.layout_y[best]);
+}
+
+void GraphGui::focus_node(const clang_interface::FunctionDecl* function) {
+  auto found = node_by_id.find(function->ID());
+  if (found == node_by_id.end()) return;
+  NodeId node = found->second;
+  reveal_node(node);
+  center_view(nodes.layout_x[node], nodes.layout_y[node]);
+  show_in_editor(node);
+}
+
+// Makes node visible by expanding every node on a shortest call path from
+// the root to it. Nodes the root can't reach become the root instead.
+void GraphGui::reveal_node(NodeId node) {
+  if (nodes.active_parents[node] > 0) return;
+
+  begin_traversal();
+  visit(root);
+  traversal.push_back(root);
+  for (size_t head = 0; head < traversal.size(); head++) {
+    NodeId current = traversal[head];
+    if (current == node) break;
+    for (NodeId neighbor : nodes.neighbors[current]) {
+      if (!visit(neighbor)) continue;
+      predecessor[neighbor] = current;
+      traversal.push_back(neighbor);
+    }
+  }
+
+  bool reachable = visit_mark[node] == visit_epoch;
+  if (!reachable) {
+    root = node;
+    root_selected = true;
+    graph_init();
+    return;
+  }
+  for (NodeId step = node; step != root;) {
+    step = predecessor[step];
+    if (!nodes.show_children[step]) show_neighbours(step);
+  }
+}
+
+void GraphGui::show_in_editor(NodeId node) {
+  // The editor only holds the main file
+  if (!nodes.function[node]->IsInMainFile()) return;
+  auto row = nodes.function[node]->LineNumber();
+  editor_pointer->SetSelection(TextEditor::Coordinates(row - 1, 0),
+                               TextEditor::Coordinates(row, 0));
+  editor_pointer->SetCursorPosition(TextEditor::Coordinates(row - 1, 0));
+}
+
+// Scrolls so the node at the given layout position is in the middle of the
+// window.
+void GraphGui::center_view(float layout_x, float layout_y) {
+  if (window == nullptr) return;
+  float x = layout_x * node_distance_x + current_node_size.x / 2;
+  float y = layout_y * node_distance_y + current_node_size.y / 2;
+  camera.translation = ImVec2(window->Size.x / 2 - x, window->Size.y / 2 - y);
+}
+
+void GraphGui::draw_minimap() {
+  if (minimap_dirty) {
+    minimap.Update(nodes.layout_x.data(), nodes.layout_y.data(),
+                   nodes.active_parents.data(), nodes.size());
+    minimap_dirty = false;
+  }
+
+  // The part of the layout the window shows, in layout units
+  ImVec2 view_min(-camera.translation.x / node_distance_x,
+                  -camera.translation.y / node_distance_y);
+  ImVec2 view_max((window->Size.x - camera.translation.x) / node_distance_x,
+                  (window->Size.y - camera.translation.y) / node_distance_y);
+
+  ImVec2 target;
+  if (minimap.Draw(minimap_rect.Min, MINIMAP_SIZE, view_min, view_max,
+                   target))
+    center_view(target.x - current_node_size.x / 2 / node_distance_x,
+                target.y - current_node_size.y / 2 / node_distance_y);
 }
 
 void GraphGui::graph_init() {
-  layers.clear();
-  layers.resize(nodes.size(), 0);
-  for (const auto& e : nodes) {
-    e->number_of_active_parents = 0;
-    e->set_display_name();
+  // Only the root stays visible, so nothing is expanded any more
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    nodes.active_parents[node] = 0;
+    nodes.show_children[node] = false;
   }
 
-  if (root == nullptr) root = nodes.front().get();
+  if (root == NO_NODE || (main_node != NO_NODE && !root_selected))
+    root = main_node != NO_NODE ? main_node : 0;
 
-  root->number_of_active_parents = 1;
+  nodes.active_parents[root] = 1;
   calculate_depth(root);
-  sort(nodes.begin(), nodes.end(),
-       [](std::unique_ptr<Node>& a, std::unique_ptr<Node>& b) {
-         return a->number_of_active_parents > b->number_of_active_parents;
-       });
-}
-
-void GraphGui::BuildCallGraph(clang_interface::CallGraph& call_graph) {
-  last_clicked_node = nullptr;
-  hovered_node = nullptr;
-  root = nullptr;
-  int index = 0;
-  int main_function_index = 0;
+  layout();
+}
+
+void GraphGui::Clear() {
+  last_clicked_node = NO_NODE;
+  hovered_node = NO_NODE;
+  root = NO_NODE;
+  requested_root = nullptr;
+  main_node = NO_NODE;
+  root_selected = false;
+  merge_pending = false;
+  main_merged = false;
   nodes.clear();
-  for (const auto& e : call_graph.nodes) {
-    nodes.emplace_back(std::make_unique<Node>());
-    nodes.back()->function = e.get();
+  node_by_id.clear();
+  node_by_group.clear();
+  node_by_name.clear();
+  group_edges.clear();
+  node_arena = Arena();
+  labels.Clear();
+  edge_count = 0;
+  layout_generation++;
+  cancel_bundling();
+  bundles = edge_bundling::Result();
+}
+
+void GraphGui::set_collapsed_scopes(const std::vector<std::string>& scopes) {
+  collapsed_scopes.clear();
+  for (const auto& scope : scopes)
+    collapsed_scopes.push_back(string_pool::Intern(scope));
+}
 
-    if (nodes.back()->function->IsMain()) main_function_index = index;
-    index++;
+// The outermost collapsed scope containing function, empty if there is none.
+std::string_view GraphGui::collapsed_scope(
+    const clang_interface::FunctionDecl* function) const {
+  std::string_view scope = function->ScopeAsString();
+  std::string_view outermost;
+  for (std::string_view collapsed : collapsed_scopes) {
+    bool inside = scope.substr(0, collapsed.size()) == collapsed &&
+                  (scope.size() == collapsed.size() ||
+                   scope.substr(collapsed.size(), 2) == "::");
+    if (inside && (outermost.empty() || collapsed.size() < outermost.size()))
+      outermost = collapsed;
+  }
+  return outermost;
+}
+
+void GraphGui::load_aggregate(const aggregation::Graph& graph) {
+  for (size_t group = 0; group < graph.names.size(); group++) {
+    NodeId node = nodes.add(graph.representative[group], graph.names[group]);
+    nodes.functions[node] = graph.functions[group];
+    node_by_name.emplace(graph.names[group],
+                         NameMatch{node, NameMatch::Signature});
+  }
+  node_by_id.insert(graph.group_by_function_id.begin(),
+                    graph.group_by_function_id.end());
+  if (graph.main_group != aggregation::NO_GROUP) main_node = graph.main_group;
+  for (const auto& edge : graph.edges) {
+    bool callees = direction == GraphDirection::Callees;
+    NodeId from_node = callees ? edge.from : edge.to;
+    NodeId to_node = callees ? edge.to : edge.from;
+    nodes.neighbors[from_node].push_back(node_arena, to_node);
+    nodes.calls[from_node].push_back(node_arena, edge.calls);
+    edge_count++;
+  }
+  if (!nodes.empty()) graph_init();
+}
+
+void GraphGui::MergeBatch(const clang_interface::CallGraphBatch& batch) {
+  for (auto function : batch.nodes) {
+    std::string_view group = collapsed_scope(function);
+    NodeId node;
+    if (group.empty()) {
+      node = nodes.add(function);
+    } else {
+      auto [existing, inserted] = node_by_group.try_emplace(group, NO_NODE);
+      if (inserted) {
+        existing->second = nodes.add(function, group);
+        node_by_name.emplace(group,
+                             NameMatch{existing->second, NameMatch::Signature});
+      } else {
+        nodes.functions[existing->second]++;
+      }
+      node = existing->second;
+    }
+    node_by_id[function->ID()] = node;
+    index_names(function, node);
+    if (function->IsMain() && main_node == NO_NODE) {
+      main_node = node;
+      main_merged = true;
+    }
   }
   if (nodes.empty()) {
     return;
   }
-  swap(nodes.at(0), nodes.at(main_function_index));
 
-  for (const auto [from, to] : call_graph.edges) {
-    auto from_node = std::find_if(
-        nodes.begin(), nodes.end(),
-        [id = from->ID()](const auto& n) { return n->function->ID() == id; });
+  for (const auto [caller, callee] : batch.edges) {
+    // A callers view walks the edges backwards
+    auto from = direction == GraphDirection::Callees ? caller : callee;
+    auto to = direction == GraphDirection::Callees ? callee : caller;
+    NodeId from_node = node_by_id.at(from->ID());
+    NodeId to_node = node_by_id.at(to->ID());
+    if (!nodes.group[from_node].empty() || !nodes.group[to_node].empty()) {
+      // Calls inside a group vanish, calls between the same nodes are drawn
+      // once.
+      if (from_node == to_node) continue;
+      uint64_t key = static_cast<uint64_t>(from_node) << 32 | to_node;
+      auto [edge, inserted] = group_edges.try_emplace(
+          key, nodes.neighbors[from_node].size());
+      if (!inserted) {
+        nodes.calls[from_node][edge->second]++;
+        continue;
+      }
+    }
+    nodes.neighbors[from_node].push_back(node_arena, to_node);
+    nodes.calls[from_node].push_back(node_arena, 1);
+    edge_count++;
+    if (nodes.show_children[from_node]) nodes.active_parents[to_node]++;
+  }
+
+  merge_pending = true;
+}
 
-    auto to_node = std::find_if(
-        nodes.begin(), nodes.end(),
-        [id = to->ID()](const auto& n) { return n->function->ID() == id; });
+void GraphGui::FinishMerge() {
+  if (!merge_pending) return;
+  merge_pending = false;
+  // main becomes the root as soon as it shows up, unless the user already
+  // picked a root from the function list.
+  if (root == NO_NODE || (main_merged && !root_selected)) {
+    graph_init();
+  } else {
+    calculate_depth(root);
+    layout();
+  }
+  main_merged = false;
+}
 
-    (*from_node)->add_edge((*to_node).get());
+void GraphGui::ApplyDiff(const clang_interface::CallGraphBatch& graph) {
+  if (nodes.empty() || !collapsed_scopes.empty()) {
+    Clear();
+    MergeBatch(graph);
+    FinishMerge();
+    return;
   }
 
+  std::unordered_map<std::string_view, size_t> new_by_signature;
+  new_by_signature.reserve(graph.nodes.size());
+  for (size_t i = 0; i < graph.nodes.size(); i++)
+    new_by_signature.try_emplace(graph.nodes[i]->SignatureAsString(), i);
+
+  // Surviving nodes keep their order and state, a function that appears
+  // twice under one signature only keeps the first node.
+  std::vector<NodeId> remap(nodes.size(), NO_NODE);
+  std::vector<NodeId> node_of_new(graph.nodes.size(), NO_NODE);
+  NodeId kept = 0;
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    auto found =
+        new_by_signature.find(nodes.function[node]->SignatureAsString());
+    if (found == new_by_signature.end() ||
+        node_of_new[found->second] != NO_NODE)
+      continue;
+    node_of_new[found->second] = kept;
+    nodes.function[node] = graph.nodes[found->second];
+    remap[node] = kept++;
+  }
+  nodes.compact(remap, kept);
+  auto remapped = [&remap](NodeId node) {
+    return node == NO_NODE ? NO_NODE : remap[node];
+  };
+  root = remapped(root);
+  last_clicked_node = remapped(last_clicked_node);
+  hovered_node = NO_NODE;
+
+  main_node = NO_NODE;
+  node_by_id.clear();
+  node_by_name.clear();
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    auto function = graph.nodes[i];
+    if (node_of_new[i] == NO_NODE) node_of_new[i] = nodes.add(function);
+    NodeId node = node_of_new[i];
+    node_by_id[function->ID()] = node;
+    index_names(function, node);
+    if (function->IsMain() && main_node == NO_NODE) main_node = node;
+  }
 
-  graph_init();
+  // Neighbor lists are rebuilt from the new edges, expansions carry over
+  // by counting the active parents again.
+  node_arena = Arena();
+  edge_count = 0;
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    nodes.neighbors[node] = {};
+    nodes.calls[node] = {};
+    nodes.active_parents[node] = 0;
+  }
+  for (const auto [caller, callee] : graph.edges) {
+    auto from = direction == GraphDirection::Callees ? caller : callee;
+    auto to = direction == GraphDirection::Callees ? callee : caller;
+    NodeId from_node = node_by_id.at(from->ID());
+    NodeId to_node = node_by_id.at(to->ID());
+    nodes.neighbors[from_node].push_back(node_arena, to_node);
+    nodes.calls[from_node].push_back(node_arena, 1);
+    edge_count++;
+    if (nodes.show_children[from_node]) nodes.active_parents[to_node]++;
+  }
+  labels.Clear();
+  if (root == NO_NODE) {
+    // The root itself was removed
+    root_selected = false;
+    requested_root = nullptr;
+    if (!nodes.empty()) graph_init();
+    return;
+  }
+  nodes.active_parents[root]++;
+  requested_root = nodes.function[root];
+  // Expanded nodes whose last expanded caller was removed disappear
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    if (nodes.show_children[node] && nodes.active_parents[node] == 0)
+      hide_neighbours(node);
+  }
+
+  // New nodes go below the existing ones in the column of their depth, so
+  // nothing that is already placed moves. Nodes no longer reachable from the
+  // root keep depth 0, their old depth may exceed the shrunk graph.
+  std::fill(nodes.depth.begin(), nodes.depth.end(), 0);
+  calculate_depth(root);
+  layers.clear();
+  layers.resize(nodes.size(), 0);
+  for (NodeId node = 0; node < kept; node++) {
+    size_t column = nodes.layout_x[node];
+    if (column >= layers.size()) layers.resize(column + 1, 0);
+    layers[column] =
+        std::max<size_t>(layers[column], nodes.layout_y[node] + 1);
+  }
+  for (NodeId node = kept; node < nodes.size(); node++) {
+    size_t column = nodes.depth[node];
+    nodes.layout_x[node] = column;
+    nodes.layout_y[node] = layers.at(column)++;
+  }
+  view_changed();
+}
+
+clang_interface::FunctionDecl* GraphGui::root_function() const {
+  return root == NO_NODE ? nullptr : nodes.function[root];
 }
 
-void Node::show_info() {
-  ImGui::Text("Name: %s", function->NameAsString().c_str());
+void GraphGui::show_info(NodeId node) {
+  const auto* function = nodes.function[node];
+  if (!nodes.group[node].empty()) {
+    // Collapsed scopes in the function view, aggregates at the other levels
+    ImGui::Text("%s: %s",
+                aggregation == aggregation::Level::Functions
+                    ? "Collapsed scope"
+                    : aggregation::LEVEL_NAMES[static_cast<int>(aggregation)],
+                nodes.group[node].data());
+    ImGui::Text("Functions: %u", nodes.functions[node]);
+    return;
+  }
+  ImGui::Text("Name: %s", function->NameAsString().data());
+  ImGui::Text("Signature: %s", function->SignatureAsString().data());
   ImGui::Text("ID: %u", function->ID());
-  ImGui::Text("ReturnType: %s", function->ReturnTypeAsString().c_str());
+  ImGui::Text("ReturnType: %s", function->ReturnTypeAsString().data());
   ImGui::Text("Function parameters: ");
   for (auto it = function->ParamBegin(); it != function->ParamEnd(); it++)
-    ImGui::Text("\t%s %s", it->TypeAsString().c_str(),
-                it->NameAsString().c_str());
+    ImGui::Text("\t%s %s", it->TypeAsString().data(),
+                it->NameAsString().data());
   if (function->ParamBegin() == function->ParamEnd()) ImGui::Text("\tNone");
 }
 
 void GraphGui::draw_node_info_window() {
-  if (hovered_node == nullptr) return;
+  if (hovered_node == NO_NODE) return;
 
   ImVec2 size = ImVec2(400, 200);
   ImVec2 pos = ImVec2(window->Pos.x + window->Size.x - size.x - 5,
@@ -344,36 +998,34 @@ void GraphGui::draw_node_info_window() {
   ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.1f, 0.1f, 0.1f, 1.0f));
   ImGui::SetNextWindowPos(pos);
   ImGui::BeginChild((char*)"node info window", size, true);
-  hovered_node->show_info();
+  show_info(hovered_node);
   ImGui::End();
   ImGui::PopStyleColor();
 }
 
 void GraphGui::shrink_graph() {
-  for (const auto& e : nodes) {
-    e->number_of_active_parents = 0;
-    e->show_children = false;
+  for (NodeId node = 0; node < nodes.size(); node++) {
+    nodes.active_parents[node] = 0;
+    nodes.show_children[node] = false;
   }
 
-  if (root == nullptr) root = nodes.front().get();
+  if (root == NO_NODE) root = 0;
 
-  root->number_of_active_parents = 1;
+  nodes.active_parents[root] = 1;
+  view_changed();
 }
 
 void GraphGui::show_full_graph() {
-  std::set<Node*> visited;
-
-  std::queue<Node*> s;
-  s.push(root);
-  while (!s.empty()) {
-    Node* node = s.front();
-    s.pop();
-
-    if (visited.find(node) != visited.end()) continue;
-    visited.insert(node);
-
-    node->show_neighbours();
-    for (Node* neighbor : node->neighbors) s.push(neighbor);
+  begin_traversal();
+  visit(root);
+  traversal.push_back(root);
+  for (size_t head = 0; head < traversal.size(); head++) {
+    NodeId current = traversal[head];
+    // Nodes already expanded would count as parents of their neighbors twice
+    if (!nodes.show_children[current]) show_neighbours(current);
+    for (NodeId neighbor : nodes.neighbors[current]) {
+      if (visit(neighbor)) traversal.push_back(neighbor);
+    }
   }
 }
 
@@ -3,111 +3,304 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <future>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <queue>
-#include <stack>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include "TextEditor.h"
+#include "aggregation.hpp"
+#include "arena.hpp"
 #include "clang_interface.h"
+#include "edge_bundling.hpp"
+#include "graph_renderer.hpp"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "imgui_internal.h"
+#include "label_cache.hpp"
+#include "minimap.hpp"
+#include "node_kernels.hpp"
 
 namespace gui {
 
-// name constants
-const static unsigned DISPLAY_NAME_LENGTH = 11;
-
-// scroll values and constants
-static float scroll_x = 0;
-static float scroll_y = 10;
+// camera constants, ZOOM_SPEED is the zoom per mouse wheel step in percent
+// and ZOOM_SMOOTHING how fast the zoom eases towards its target (1/s)
 const static float SCROLL_SPEED = 10;
-const static float ZOOM_SPEED = 3;
-const static float NODE_MIN_SIZE_Y = 60;
+const static float ZOOM_SPEED = 15;
+const static float ZOOM_SMOOTHING = 20;
+const static float NODE_DEFAULT_SIZE = 60;
+// distance between layout grid cells at scale 1
+const static float NODE_SPACING = 1.5f * NODE_DEFAULT_SIZE;
+const static float NODE_MIN_SIZE_Y = 2;
 const static float NODE_MIN_SIZE_X = NODE_MIN_SIZE_Y;
-const static float NODE_MAX_SIZE_Y = 4 * NODE_MIN_SIZE_Y;
-const static float NODE_MAX_SIZE_X = NODE_MIN_SIZE_Y;
+const static float NODE_MAX_SIZE_Y = 4 * NODE_DEFAULT_SIZE;
+const static float NODE_MAX_SIZE_X = NODE_DEFAULT_SIZE;
+
+// level of detail: below LOD_LABEL_MIN_SIZE labels and arrow heads are
+// hidden, below LOD_POINT_MAX_SIZE nodes are drawn as points and edges are
+// merged into one stroke per pair of EDGE_BUNDLE_CELL sized screen cells.
+const static float LOD_LABEL_MIN_SIZE = 30;
+const static float LOD_POINT_MAX_SIZE = 10;
+const static float LOD_POINT_RADIUS = 1.5f;
+const static float EDGE_BUNDLE_CELL = 16;
+
+// minimap size in the top right corner of the graph window
+const static ImVec2 MINIMAP_SIZE(160, 200);
 
-// focus value
-static bool refresh_nodes = false;
+// edge bundling is skipped for views showing more edges than this
+const static size_t MAX_BUNDLED_EDGES = 100000;
 
 // node constants
-static ImVec2 current_node_size(NODE_MIN_SIZE_X, NODE_MIN_SIZE_Y);
-static ImU32 col32Node = ImColor(0.f, 247.f / 255.f, 1.f);
-static ImU32 col32Text = ImColor(1.f, 1.f, 1.f);
-
-struct Node {
-  ImVec2 position;
-  ImVec2 size;
-  clang_interface::FunctionDecl* function;
-  std::vector<Node*> neighbors;
-  char display_name[DISPLAY_NAME_LENGTH];
-
-  int depth;
-  bool show_children;
-  size_t number_of_active_parents;
-
-  void init();
-  void set_display_name();
-  Node();
-  Node(clang_interface::FunctionDecl* _function);
-
-  inline ImVec2 get_absolute_position() {
-    return ImVec2(scroll_x + position.x, scroll_y + position.y);
-  }
-
-  inline void set_position(ImVec2 new_position) { position = new_position; }
-  inline void set_depth(int new_depth) { depth = new_depth; }
-  inline void set_size(ImVec2 new_size) { size = new_size; }
-  inline void add_edge(Node* node) { neighbors.push_back(node); }
-
-  void show_neighbours();
-  void hide_neighbours();
-  void show_info();
-  void draw(ImGuiWindow* window, const ImU32& line_color,
-            size_t line_thickness);
+const static ImU32 col32Node = ImColor(0.f, 247.f / 255.f, 1.f);
+const static ImU32 col32Text = ImColor(1.f, 1.f, 1.f);
+
+// Maps world coordinates (layout cells times NODE_SPACING) to window
+// coordinates: window = world * scale + translation. Panning and zooming
+// only change the camera, node positions are derived from it when drawing.
+struct Camera {
+  ImVec2 translation = ImVec2(25, 50);
+  float scale = 1;
+  // Zoom eases from scale to target_scale, keeping the world point under
+  // zoom_anchor (window coordinates) in place.
+  float target_scale = 1;
+  ImVec2 zoom_anchor;
+
+  bool animating() const { return scale != target_scale; }
+  void zoom(float factor, ImVec2 anchor);
+  void update(float delta_time);
 };
 
-// Last clicked node
-static Node* last_clicked_node = nullptr;
-static Node* hovered_node = nullptr;
-static Node* root = nullptr;
+using NodeId = unsigned;
+const static NodeId NO_NODE = ~0u;
+
+// Graph view state as structure-of-arrays indexed by NodeId. The fields read
+// by the per-frame transform, culling and hit-testing loops (layout position
+// and visibility) are contiguous arrays of their own, the rest is kept apart.
+// Every node is drawn with current_node_size, so no per-node size is stored.
+struct NodeStore {
+  // hot: layout position in grid cells, x is the depth column and y the row
+  // inside it. A node is visible while it has active parents.
+  std::vector<float> layout_x;
+  std::vector<float> layout_y;
+  std::vector<unsigned> active_parents;
+  std::vector<uint8_t> show_children;
+
+  // cold
+  std::vector<int> depth;
+  std::vector<clang_interface::FunctionDecl*> function;
+  // Collapsed scope a group node stands for, empty for function nodes. A
+  // group node's function is the first function of the scope merged in.
+  std::vector<std::string_view> group;
+  // Functions a node stands for, more than one only for group nodes
+  std::vector<unsigned> functions;
+  std::vector<ArenaVector<NodeId>> neighbors;
+  // Call graph edges each neighbor edge stands for, parallel to neighbors.
+  // More than one only when a group node is involved.
+  std::vector<ArenaVector<unsigned>> calls;
+
+  size_t size() const { return function.size(); }
+  bool empty() const { return function.empty(); }
+  NodeId add(clang_interface::FunctionDecl* node_function,
+             std::string_view node_group = {});
+  // Moves every node to remap[node], dropping those mapped to NO_NODE. The
+  // remap keeps the order of the remaining nodes and leaves count of them.
+  void compact(const std::vector<NodeId>& remap, size_t count);
+  void clear();
+};
 
+// Which way a view follows edges from its root.
+enum class GraphDirection { Callees, Callers };
+
+enum class DetailLevel { Full, Shapes, Points };
+
+// One call graph view. All view state lives in the object, so several views
+// can be open side by side, each with its own root, layout and camera.
 class GraphGui {
  private:
-  ImGuiWindow* window;
-  std::vector<std::unique_ptr<Node>> nodes;
+  ImGuiWindow* window = nullptr;
+  std::string title;
+  GraphDirection direction;
+  // Neighbor lists live in node_arena, Clear releases them all at once.
+  Arena node_arena;
+  NodeStore nodes;
+  std::unordered_map<unsigned, NodeId> node_by_id;
+  // Functions inside a collapsed scope all map to its group node. Scopes
+  // are interned.
+  std::vector<std::string_view> collapsed_scopes;
+  std::unordered_map<std::string_view, NodeId> node_by_group;
+  // Nodes by signature, qualified name, plain name and group name, for
+  // focusing the text selected in the editor.
+  struct NameMatch {
+    enum Rank { Name, QualifiedName, Signature };
+    NodeId node;
+    Rank rank;
+  };
+  std::unordered_multimap<std::string_view, NameMatch> node_by_name;
+  // Position in neighbors[from] of (from, to) pairs involving a group node
+  std::unordered_map<uint64_t, unsigned> group_edges;
+  aggregation::Level aggregation = aggregation::Level::Functions;
+  bool aggregation_changed = false;
+  NodeId main_node = NO_NODE;
+  NodeId root = NO_NODE;
+  // Last root handed to draw, it only re-roots the view when this changes.
+  const clang_interface::FunctionDecl* requested_root = nullptr;
+  NodeId last_clicked_node = NO_NODE;
+  NodeId hovered_node = NO_NODE;
+  bool root_selected = false;
+  // Batches merged since the last FinishMerge, and whether main was in them
+  bool merge_pending = false;
+  bool main_merged = false;
   std::vector<size_t> layers;
+
+  // Scratch space of the graph traversals. A node is visited while its mark
+  // equals visit_epoch, so starting a traversal doesn't clear anything.
+  std::vector<unsigned> visit_mark;
+  unsigned visit_epoch = 0;
+  std::vector<NodeId> predecessor;
+  // BFS queue or DFS stack
+  std::vector<NodeId> traversal;
+
+  // Output of the per-frame transform, indexed by NodeId.
+  std::vector<float> screen_x;
+  std::vector<float> screen_y;
+  std::vector<uint8_t> on_screen;
+  // Edge strokes merged at DetailLevel::Points, reused between frames.
+  std::unordered_map<uint64_t, unsigned> edge_bundles;
+
+  // Bundled edge polylines in layout coordinates of the visible edges,
+  // computed on a background thread after every change of the layout or of
+  // the visible nodes. Edge i is the i-th (node, neighbor) pair in NodeId
+  // order, bundle_index[i] its polyline, NO_BUNDLE when it was hidden. Only
+  // used while bundles_generation matches.
+  static constexpr unsigned NO_BUNDLE = ~0u;
+  size_t edge_count = 0;
+  unsigned layout_generation = 0;
+  unsigned bundles_generation = ~0u;
+  unsigned bundling_job_generation = 0;
+  std::shared_ptr<std::atomic<bool>> bundling_cancelled;
+  std::future<edge_bundling::Result> bundling_job;
+  edge_bundling::Result bundles;
+  std::vector<unsigned> bundle_index;
+  std::vector<unsigned> job_bundle_index;
+  std::vector<ImVec2> polyline;
+  bool bundle_edges = true;
+
   ImGuiIO* io_pointer;
   TextEditor* editor_pointer;
+  GraphRenderer renderer;
+  LabelCache labels;
+  Minimap minimap;
+  // Set whenever the layout or the visible nodes change
+  bool minimap_dirty = true;
+  bool show_minimap = true;
+  ImRect minimap_rect;
+
+  Camera camera;
+  // Derived from the camera once per frame by update_camera
+  ImVec2 current_node_size = ImVec2(NODE_DEFAULT_SIZE, NODE_DEFAULT_SIZE);
+  float node_distance_x = NODE_SPACING;
+  float node_distance_y = NODE_SPACING;
 
   // constants
-  int top_distance = 40;
-  int left_distance = 25;
-  int node_distance_x = 175;
-  int node_distance_y = 100;
   int node_line_thickness = 5;
   ImU32 node_line_color = IM_COL32(255, 165, 0, 100);
 
   bool& p_show;
 
+  void show_neighbours(NodeId node);
+  void hide_neighbours(NodeId node);
+  void show_info(NodeId node);
+  void view_changed();
+  void layout();
+  void center_view(float layout_x, float layout_y);
+  void show_in_editor(NodeId node);
+  void index_names(const clang_interface::FunctionDecl* function,
+                   NodeId node);
+  void reveal_node(NodeId node);
+  void begin_traversal();
+  bool visit(NodeId node);
+  std::string_view collapsed_scope(
+      const clang_interface::FunctionDecl* function) const;
+  void update_camera();
+  void draw_minimap();
+  void transform_nodes();
+  void draw_node(NodeId node);
+  void draw_label(NodeId node);
+  void draw_edge(ImVec2 start_position, ImVec2 end_position, size_t edge,
+                 unsigned calls, bool arrow);
+  void draw_arrow(ImVec2 start_position, ImVec2 end_position);
+  bool has_bundles() const;
+  bool bundles_ready() const;
+  void cancel_bundling();
+  void update_bundles();
+  void draw_edges(DetailLevel detail);
+  void draw_edge_bundles();
+  DetailLevel detail_level() const;
+
  public:
-  GraphGui(ImGuiIO* io, TextEditor* editor, bool& p_show)
-      : io_pointer(io), editor_pointer(editor), p_show(p_show) {}
-  void BuildCallGraph(clang_interface::CallGraph& call_graph);
+  // title is the ImGui window name, it has to be unique among the views.
+  GraphGui(ImGuiIO* io, TextEditor* editor, bool& p_show,
+           std::string title = "Generated Callgraph",
+           GraphDirection direction = GraphDirection::Callees)
+      : title(std::move(title)),
+        direction(direction),
+        io_pointer(io),
+        editor_pointer(editor),
+        p_show(p_show) {}
+  ~GraphGui();
+  void Clear();
+  // Adds the nodes and edges of batch. Depths and layout are only updated
+  // by FinishMerge, so merging many batches in one frame lays out once.
+  void MergeBatch(const clang_interface::CallGraphBatch& batch);
+  void FinishMerge();
+  // Replaces the merged graph by graph, a complete extraction of the edited
+  // source, matching functions by signature. Nodes of functions that
+  // disappeared are dropped and new ones placed next to their callers, the
+  // rest keeps its position and expansion state. Views with collapsed
+  // scopes are merged again from scratch. The previous FunctionDecls have to
+  // be alive during the call, afterwards the view only references graph.
+  void ApplyDiff(const clang_interface::CallGraphBatch& graph);
+  // Function of the root node, nullptr while the view is empty.
+  clang_interface::FunctionDecl* root_function() const;
+  // Functions in these scopes, or nested deeper inside them, are drawn as
+  // one node per scope. Only applies to batches merged afterwards, so the
+  // caller clears the view and merges the graph again.
+  void set_collapsed_scopes(const std::vector<std::string>& scopes);
+  // The level picked in the view. When it changed, the caller clears the
+  // view and loads the matching aggregate, or merges the functions again,
+  // and then acknowledges with aggregation_applied.
+  aggregation::Level aggregation_level() const { return aggregation; }
+  bool aggregation_pending() const { return aggregation_changed; }
+  void aggregation_applied() { aggregation_changed = false; }
+  void load_aggregate(const aggregation::Graph& graph);
   void set_window(ImGuiWindow* new_window);
+  // True when a background result arrived that the next frame should show.
+  // A hidden view collects it once it is drawn again.
+  bool has_pending_results() const { return p_show && bundles_ready(); }
+  // True while the view changes without input, e.g. during a smooth zoom.
+  bool is_animating() const { return camera.animating(); }
+  // Switches nodes and edges to instanced OpenGL drawing when the context
+  // supports it, needs the GL context to be current.
+  void init_renderer(const char* glsl_version);
   void draw(clang_interface::FunctionDecl* function);
-  void calculate_depth(Node* node);
-  void refresh();
+  void calculate_depth(NodeId node);
   void key_input_check();
 
+  // Centers the node whose signature, qualified name or name is
+  // node_signature, in that order of preference. Hidden nodes are revealed
+  // by expanding the path from the root to them.
   void focus_node(const std::string& node_signature);
+  // Centers and reveals the node of function and selects its line in the
+  // editor.
+  void focus_node(const clang_interface::FunctionDecl* function);
   void draw_node_info_window();
   void graph_init();
   void shrink_graph();
@@ -0,0 +1,281 @@
+#include "graph_metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <utility>
+
+namespace graph_metrics {
+
+namespace {
+
+constexpr uint32_t UNVISITED = ~0u;
+
+// Tarjan's algorithm without recursion, call graphs can be deeper than the
+// stack. Components come out in reverse topological order: every component
+// is emitted after all components it calls into.
+std::vector<uint32_t> StronglyConnectedComponents(const Graph& graph,
+                                                  uint32_t& component_count) {
+  size_t n = graph.size();
+  std::vector<uint32_t> component(n, UNVISITED);
+  std::vector<uint32_t> index(n, UNVISITED);
+  std::vector<uint32_t> low_link(n);
+  std::vector<uint32_t> stack;
+  // (node, next edge to look at)
+  std::vector<std::pair<uint32_t, uint32_t>> call_stack;
+  uint32_t next_index = 0;
+  component_count = 0;
+
+  for (uint32_t start = 0; start < n; start++) {
+    if (index[start] != UNVISITED) continue;
+    call_stack.push_back({start, graph.offsets[start]});
+    index[start] = low_link[start] = next_index++;
+    stack.push_back(start);
+    while (!call_stack.empty()) {
+      auto& [node, edge] = call_stack.back();
+      if (edge < graph.offsets[node + 1]) {
+        uint32_t callee = graph.callees[edge++];
+        if (index[callee] == UNVISITED) {
+          index[callee] = low_link[callee] = next_index++;
+          stack.push_back(callee);
+          call_stack.push_back({callee, graph.offsets[callee]});
+        } else if (component[callee] == UNVISITED) {
+          low_link[node] = std::min(low_link[node], index[callee]);
+        }
+        continue;
+      }
+      uint32_t finished = node;
+      call_stack.pop_back();
+      if (!call_stack.empty()) {
+        uint32_t parent = call_stack.back().first;
+        low_link[parent] = std::min(low_link[parent], low_link[finished]);
+      }
+      if (low_link[finished] == index[finished]) {
+        uint32_t member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          component[member] = component_count;
+        } while (member != finished);
+        component_count++;
+      }
+    }
+  }
+  return component;
+}
+
+std::vector<unsigned> CallDepth(const Graph& graph) {
+  uint32_t component_count;
+  auto component = StronglyConnectedComponents(graph, component_count);
+  std::vector<std::vector<uint32_t>> members(component_count);
+  for (uint32_t node = 0; node < graph.size(); node++)
+    members[component[node]].push_back(node);
+
+  // Callee components come first, so their depth is final when a caller
+  // component is reached.
+  std::vector<unsigned> component_depth(component_count, 0);
+  for (uint32_t c = 0; c < component_count; c++) {
+    for (uint32_t node : members[c]) {
+      for (uint32_t e = graph.offsets[node]; e < graph.offsets[node + 1];
+           e++) {
+        uint32_t callee_component = component[graph.callees[e]];
+        if (callee_component != c) {
+          component_depth[c] = std::max(component_depth[c],
+                                        component_depth[callee_component] + 1);
+        }
+      }
+    }
+  }
+  std::vector<unsigned> depth(graph.size());
+  for (uint32_t node = 0; node < graph.size(); node++)
+    depth[node] = component_depth[component[node]];
+  return depth;
+}
+
+std::vector<float> PageRank(const Graph& graph, const Options& options,
+                            const std::atomic<bool>& cancelled) {
+  size_t n = graph.size();
+  std::vector<double> rank(n, 1.0 / n);
+  std::vector<double> next(n);
+  for (int iteration = 0; iteration < options.max_iterations; iteration++) {
+    if (cancelled) return {};
+    // Functions calling nothing hand their rank to every function evenly
+    double dangling = 0;
+    for (uint32_t node = 0; node < n; node++)
+      if (graph.offsets[node] == graph.offsets[node + 1])
+        dangling += rank[node];
+    std::fill(next.begin(), next.end(),
+              (1 - options.damping + options.damping * dangling) / n);
+    for (uint32_t node = 0; node < n; node++) {
+      uint32_t first = graph.offsets[node], last = graph.offsets[node + 1];
+      if (first == last) continue;
+      double share = options.damping * rank[node] / (last - first);
+      for (uint32_t e = first; e < last; e++) next[graph.callees[e]] += share;
+    }
+    double change = 0;
+    for (uint32_t node = 0; node < n; node++)
+      change += std::abs(next[node] - rank[node]);
+    rank.swap(next);
+    if (change < options.tolerance) break;
+  }
+  return std::vector<float>(rank.begin(), rank.end());
+}
+
+// Brandes' algorithm, accumulating the dependencies of every source into
+// betweenness. Unweighted, so each source is one BFS.
+class Brandes {
+ private:
+  const Graph& graph;
+  std::vector<double> paths;
+  std::vector<uint32_t> distance;
+  std::vector<double> dependency;
+  std::vector<uint32_t> order;
+
+ public:
+  std::vector<double> betweenness;
+
+  explicit Brandes(const Graph& graph)
+      : graph(graph),
+        paths(graph.size()),
+        distance(graph.size(), UNVISITED),
+        dependency(graph.size()),
+        betweenness(graph.size()) {}
+
+  void AddSource(uint32_t source) {
+    order.clear();
+    paths[source] = 1;
+    distance[source] = 0;
+    order.push_back(source);
+    for (size_t head = 0; head < order.size(); head++) {
+      uint32_t node = order[head];
+      for (uint32_t e = graph.offsets[node]; e < graph.offsets[node + 1];
+           e++) {
+        uint32_t callee = graph.callees[e];
+        if (distance[callee] == UNVISITED) {
+          distance[callee] = distance[node] + 1;
+          order.push_back(callee);
+        }
+        if (distance[callee] == distance[node] + 1)
+          paths[callee] += paths[node];
+      }
+    }
+    // Walking back in BFS order every callee's dependency is complete
+    // before its callers read it.
+    for (size_t i = order.size(); i-- > 0;) {
+      uint32_t node = order[i];
+      for (uint32_t e = graph.offsets[node]; e < graph.offsets[node + 1];
+           e++) {
+        uint32_t callee = graph.callees[e];
+        if (distance[callee] == distance[node] + 1)
+          dependency[node] +=
+              paths[node] / paths[callee] * (1 + dependency[callee]);
+      }
+      if (node != source) betweenness[node] += dependency[node];
+    }
+    for (uint32_t node : order) {
+      paths[node] = 0;
+      distance[node] = UNVISITED;
+      dependency[node] = 0;
+    }
+  }
+};
+
+std::vector<float> Betweenness(const Graph& graph, const Options& options,
+                               bool& sampled,
+                               const std::atomic<bool>& cancelled) {
+  size_t n = graph.size();
+  std::vector<uint32_t> sources(n);
+  std::iota(sources.begin(), sources.end(), 0);
+  sampled = n > options.exact_betweenness_nodes &&
+            n > options.betweenness_samples;
+  if (sampled) {
+    // Fixed seed, the same graph always ranks the same way
+    std::mt19937 random(0x5eed);
+    std::shuffle(sources.begin(), sources.end(), random);
+    sources.resize(options.betweenness_samples);
+  }
+
+  unsigned threads = options.threads != 0
+                         ? options.threads
+                         : std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min<size_t>(threads, sources.size());
+  std::vector<Brandes> workers(threads, Brandes(graph));
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back([&, t] {
+      for (size_t i = t; i < sources.size() && !cancelled; i += threads)
+        workers[t].AddSource(sources[i]);
+    });
+  }
+  for (auto& thread : pool) thread.join();
+  if (cancelled) return {};
+
+  double scale = sampled ? static_cast<double>(n) / sources.size() : 1;
+  std::vector<float> betweenness(n);
+  for (uint32_t node = 0; node < n; node++) {
+    double sum = 0;
+    for (const auto& worker : workers) sum += worker.betweenness[node];
+    betweenness[node] = sum * scale;
+  }
+  return betweenness;
+}
+
+}  // namespace
+
+Graph FromEdges(size_t node_count,
+                const std::vector<std::pair<uint32_t, uint32_t>>& edges) {
+  Graph graph;
+  graph.offsets.assign(node_count + 1, 0);
+  for (const auto& edge : edges) graph.offsets[edge.first + 1]++;
+  std::partial_sum(graph.offsets.begin(), graph.offsets.end(),
+                   graph.offsets.begin());
+  graph.callees.resize(edges.size());
+  std::vector<uint32_t> fill(graph.offsets.begin(), graph.offsets.end() - 1);
+  for (const auto& edge : edges)
+    graph.callees[fill[edge.first]++] = edge.second;
+
+  // Every call site is an edge, a callee called twice is still one callee
+  uint32_t kept = 0;
+  for (size_t node = 0; node < node_count; node++) {
+    auto first = graph.callees.begin() + graph.offsets[node];
+    auto last = graph.callees.begin() + graph.offsets[node + 1];
+    std::sort(first, last);
+    auto unique_end = std::unique(first, last);
+    graph.offsets[node] = kept;
+    kept = std::copy(first, unique_end, graph.callees.begin() + kept) -
+           graph.callees.begin();
+  }
+  graph.offsets[node_count] = kept;
+  graph.callees.resize(kept);
+  return graph;
+}
+
+Metrics Compute(const Graph& graph, const Options& options,
+                const std::atomic<bool>& cancelled) {
+  Metrics metrics;
+  size_t n = graph.size();
+  metrics.fan_in.assign(n, 0);
+  metrics.fan_out.resize(n);
+  for (uint32_t node = 0; node < n; node++) {
+    metrics.fan_out[node] = graph.offsets[node + 1] - graph.offsets[node];
+    for (uint32_t e = graph.offsets[node]; e < graph.offsets[node + 1]; e++)
+      metrics.fan_in[graph.callees[e]]++;
+  }
+  if (n == 0) {
+    metrics.complete = true;
+    return metrics;
+  }
+
+  metrics.depth = CallDepth(graph);
+  if (cancelled) return metrics;
+  metrics.pagerank = PageRank(graph, options, cancelled);
+  if (cancelled) return metrics;
+  metrics.betweenness =
+      Betweenness(graph, options, metrics.betweenness_sampled, cancelled);
+  metrics.complete = !cancelled;
+  return metrics;
+}
+
+};  // namespace graph_metrics
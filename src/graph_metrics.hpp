@@ -0,0 +1,60 @@
+#ifndef GRAPH_METRICS_HPP
+#define GRAPH_METRICS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structural metrics of a call graph: how many functions call a function
+// and how many it calls, the longest call chain below it, its PageRank and
+// its betweenness centrality. High PageRank marks functions many call paths
+// end up in, high betweenness marks functions many shortest call paths run
+// through.
+namespace graph_metrics {
+
+// Call graph in compressed sparse row form, the callees of node n are
+// callees[offsets[n]] to callees[offsets[n + 1] - 1].
+struct Graph {
+  std::vector<uint32_t> offsets{0};
+  std::vector<uint32_t> callees;
+
+  size_t size() const { return offsets.size() - 1; }
+};
+
+// Builds a Graph of node_count nodes from (caller, callee) pairs. Pairs
+// repeated for every call site are merged, so fan-in and fan-out count
+// functions and repeated calls don't weigh into PageRank and betweenness.
+Graph FromEdges(size_t node_count,
+                const std::vector<std::pair<uint32_t, uint32_t>>& edges);
+
+struct Options {
+  float damping = 0.85f;
+  int max_iterations = 100;
+  double tolerance = 1e-6;  // summed rank change that ends the iteration
+  // Up to this many nodes betweenness is exact, beyond it a BFS runs from
+  // this many sampled sources only and the result is scaled up.
+  size_t exact_betweenness_nodes = 4000;
+  size_t betweenness_samples = 256;
+  unsigned threads = 0;  // 0 uses every hardware thread
+};
+
+struct Metrics {
+  std::vector<unsigned> fan_in;
+  std::vector<unsigned> fan_out;
+  // Longest call chain below a function, functions calling each other
+  // recursively count as one step.
+  std::vector<unsigned> depth;
+  std::vector<float> pagerank;
+  std::vector<float> betweenness;
+  bool betweenness_sampled = false;
+  // False when the computation was cancelled, the rest is then unusable.
+  bool complete = false;
+};
+
+Metrics Compute(const Graph& graph, const Options& options,
+                const std::atomic<bool>& cancelled);
+
+};  // namespace graph_metrics
+
+#endif  // GRAPH_METRICS_HPP
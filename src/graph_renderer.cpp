@@ -0,0 +1,381 @@
+#include "graph_renderer.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include "gui.hpp"
+
+namespace gui {
+
+namespace {
+
+constexpr int EDGE_SEGMENTS = 16;
+
+const char* NODE_VERTEX_SHADER = R"(
+uniform mat4 ProjMtx;
+in vec3 Node;
+in vec4 Color;
+out vec2 Frag_Local;
+out float Frag_Radius;
+out vec4 Frag_Color;
+void main() {
+  vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+  // One pixel of margin for the anti-aliased rim.
+  Frag_Local = (corner * 2.0 - 1.0) * (Node.z + 1.0);
+  Frag_Radius = Node.z;
+  Frag_Color = Color;
+  gl_Position = ProjMtx * vec4(Node.xy + Frag_Local, 0.0, 1.0);
+}
+)";
+
+const char* NODE_FRAGMENT_SHADER = R"(
+in vec2 Frag_Local;
+in float Frag_Radius;
+in vec4 Frag_Color;
+out vec4 Out_Color;
+void main() {
+  float rim = length(Frag_Local) - Frag_Radius;
+  Out_Color = vec4(Frag_Color.rgb, Frag_Color.a * clamp(0.5 - rim, 0.0, 1.0));
+}
+)";
+
+const char* EDGE_VERTEX_SHADER = R"(
+uniform mat4 ProjMtx;
+uniform float Segments;
+in vec4 Start;
+in vec4 End;
+in float Thickness;
+in vec4 Color;
+out vec4 Frag_Color;
+void main() {
+  float t = float(gl_VertexID / 2) / Segments;
+  float side = float(gl_VertexID % 2) - 0.5;
+  vec2 p0 = Start.xy;
+  vec2 p1 = Start.zw;
+  vec2 p2 = End.xy;
+  vec2 p3 = End.zw;
+  float u = 1.0 - t;
+  vec2 position = u * u * u * p0 + 3.0 * u * u * t * p1 +
+                  3.0 * u * t * t * p2 + t * t * t * p3;
+  vec2 tangent = 3.0 * u * u * (p1 - p0) + 6.0 * u * t * (p2 - p1) +
+                 3.0 * t * t * (p3 - p2);
+  if (dot(tangent, tangent) < 1e-6) tangent = p3 - p0;
+  vec2 normal = normalize(vec2(-tangent.y, tangent.x));
+  Frag_Color = Color;
+  gl_Position = ProjMtx * vec4(position + normal * side * Thickness, 0.0, 1.0);
+}
+)";
+
+const char* ARROW_VERTEX_SHADER = R"(
+uniform mat4 ProjMtx;
+in vec3 Arrow;
+in vec4 Color;
+out vec4 Frag_Color;
+void main() {
+  vec2 position = Arrow.xy;
+  if (gl_VertexID == 1) position += vec2(-10.0 * Arrow.z, 5.0);
+  if (gl_VertexID == 2) position += vec2(-10.0 * Arrow.z, -5.0);
+  Frag_Color = Color;
+  gl_Position = ProjMtx * vec4(position, 0.0, 1.0);
+}
+)";
+
+const char* COLOR_FRAGMENT_SHADER = R"(
+in vec4 Frag_Color;
+out vec4 Out_Color;
+void main() { Out_Color = Frag_Color; }
+)";
+
+bool HasInstancedArrays() {
+#if defined(IMGUI_IMPL_OPENGL_LOADER_GLEW)
+  return GLEW_VERSION_3_1 && (GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays);
+#else
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  return major > 3 || (major == 3 && minor >= 3);
+#endif
+}
+
+void VertexAttribDivisor(GLuint index, GLuint divisor) {
+#if defined(IMGUI_IMPL_OPENGL_LOADER_GLEW)
+  if (!GLEW_VERSION_3_3) {
+    glVertexAttribDivisorARB(index, divisor);
+    return;
+  }
+#endif
+  glVertexAttribDivisor(index, divisor);
+}
+
+GLuint CompileShader(GLenum type, const std::string& source) {
+  GLuint shader = glCreateShader(type);
+  const char* source_data = source.c_str();
+  glShaderSource(shader, 1, &source_data, nullptr);
+  glCompileShader(shader);
+  GLint status = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    fprintf(stderr, "Graph renderer shader failed to compile:\n%s\n", log);
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+GLuint LinkProgram(const char* glsl_version, const char* vertex_source,
+                   const char* fragment_source) {
+  std::string header = std::string(glsl_version) + "\n";
+  GLuint vertex = CompileShader(GL_VERTEX_SHADER, header + vertex_source);
+  GLuint fragment = CompileShader(GL_FRAGMENT_SHADER, header + fragment_source);
+  if (!vertex || !fragment) {
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    return 0;
+  }
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vertex);
+  glAttachShader(program, fragment);
+  glBindFragDataLocation(program, 0, "Out_Color");
+  glLinkProgram(program);
+  glDeleteShader(vertex);
+  glDeleteShader(fragment);
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024];
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    fprintf(stderr, "Graph renderer shader failed to link:\n%s\n", log);
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+// Location of an active vertex attribute, -1 when the linker optimized it
+// out or the name is wrong.
+GLint AttributeLocation(GLuint program, const char* name) {
+  GLint location = glGetAttribLocation(program, name);
+  if (location < 0)
+    fprintf(stderr, "Graph renderer shader has no attribute %s\n", name);
+  return location;
+}
+
+// Per-instance float attribute read from the pipeline's instance buffer.
+bool InstanceAttribute(GLuint program, const char* name, GLint size,
+                       GLsizei stride, size_t offset) {
+  GLint location = AttributeLocation(program, name);
+  if (location < 0) return false;
+  glEnableVertexAttribArray(location);
+  glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride,
+                        reinterpret_cast<const GLvoid*>(offset));
+  VertexAttribDivisor(location, 1);
+  return true;
+}
+
+bool ColorAttribute(GLuint program, GLsizei stride, size_t offset) {
+  GLint location = AttributeLocation(program, "Color");
+  if (location < 0) return false;
+  glEnableVertexAttribArray(location);
+  glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                        reinterpret_cast<const GLvoid*>(offset));
+  VertexAttribDivisor(location, 1);
+  return true;
+}
+
+template <typename Instance>
+void Upload(GLuint buffer, const std::vector<Instance>& instances) {
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(Instance),
+               instances.data(), GL_STREAM_DRAW);
+}
+
+}  // namespace
+
+bool GraphRenderer::Init(const char* glsl_version) {
+  if (!HasInstancedArrays()) {
+    return false;
+  }
+  node_pipeline.program =
+      LinkProgram(glsl_version, NODE_VERTEX_SHADER, NODE_FRAGMENT_SHADER);
+  edge_pipeline.program =
+      LinkProgram(glsl_version, EDGE_VERTEX_SHADER, COLOR_FRAGMENT_SHADER);
+  arrow_pipeline.program =
+      LinkProgram(glsl_version, ARROW_VERTEX_SHADER, COLOR_FRAGMENT_SHADER);
+  if (!node_pipeline.program || !edge_pipeline.program ||
+      !arrow_pipeline.program) {
+    DestroyPipeline(node_pipeline);
+    DestroyPipeline(edge_pipeline);
+    DestroyPipeline(arrow_pipeline);
+    return false;
+  }
+
+  GLint last_vertex_array, last_array_buffer;
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vertex_array);
+  glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &last_array_buffer);
+  for (Pipeline* pipeline : {&node_pipeline, &edge_pipeline, &arrow_pipeline}) {
+    glGenVertexArrays(1, &pipeline->vertex_array);
+    glGenBuffers(1, &pipeline->instance_buffer);
+    glBindVertexArray(pipeline->vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, pipeline->instance_buffer);
+    pipeline->projection_location =
+        glGetUniformLocation(pipeline->program, "ProjMtx");
+  }
+
+  // A missing attribute fails the setup like a shader that doesn't link
+  glBindVertexArray(node_pipeline.vertex_array);
+  glBindBuffer(GL_ARRAY_BUFFER, node_pipeline.instance_buffer);
+  bool attributes =
+      InstanceAttribute(node_pipeline.program, "Node", 3, sizeof(NodeInstance),
+                        offsetof(NodeInstance, x)) &&
+      ColorAttribute(node_pipeline.program, sizeof(NodeInstance),
+                     offsetof(NodeInstance, color));
+
+  glBindVertexArray(edge_pipeline.vertex_array);
+  glBindBuffer(GL_ARRAY_BUFFER, edge_pipeline.instance_buffer);
+  attributes = attributes &&
+               InstanceAttribute(edge_pipeline.program, "Start", 4,
+                                 sizeof(EdgeInstance),
+                                 offsetof(EdgeInstance, p0_x)) &&
+               InstanceAttribute(edge_pipeline.program, "End", 4,
+                                 sizeof(EdgeInstance),
+                                 offsetof(EdgeInstance, p2_x)) &&
+               InstanceAttribute(edge_pipeline.program, "Thickness", 1,
+                                 sizeof(EdgeInstance),
+                                 offsetof(EdgeInstance, thickness)) &&
+               ColorAttribute(edge_pipeline.program, sizeof(EdgeInstance),
+                              offsetof(EdgeInstance, color));
+
+  glBindVertexArray(arrow_pipeline.vertex_array);
+  glBindBuffer(GL_ARRAY_BUFFER, arrow_pipeline.instance_buffer);
+  attributes = attributes &&
+               InstanceAttribute(arrow_pipeline.program, "Arrow", 3,
+                                 sizeof(ArrowInstance),
+                                 offsetof(ArrowInstance, tip_x)) &&
+               ColorAttribute(arrow_pipeline.program, sizeof(ArrowInstance),
+                              offsetof(ArrowInstance, color));
+
+  glBindVertexArray(last_vertex_array);
+  glBindBuffer(GL_ARRAY_BUFFER, last_array_buffer);
+  if (!attributes) {
+    DestroyPipeline(node_pipeline);
+    DestroyPipeline(edge_pipeline);
+    DestroyPipeline(arrow_pipeline);
+    return false;
+  }
+  available = true;
+  return true;
+}
+
+void GraphRenderer::DestroyPipeline(Pipeline& pipeline) {
+  if (pipeline.program) glDeleteProgram(pipeline.program);
+  if (pipeline.vertex_array) glDeleteVertexArrays(1, &pipeline.vertex_array);
+  if (pipeline.instance_buffer) glDeleteBuffers(1, &pipeline.instance_buffer);
+  pipeline = Pipeline();
+}
+
+GraphRenderer::~GraphRenderer() {
+  DestroyPipeline(node_pipeline);
+  DestroyPipeline(edge_pipeline);
+  DestroyPipeline(arrow_pipeline);
+}
+
+void GraphRenderer::Clear() {
+  nodes.clear();
+  edges.clear();
+  arrows.clear();
+}
+
+void GraphRenderer::AddNode(ImVec2 center, float radius, ImU32 color) {
+  nodes.push_back({center.x, center.y, radius, color});
+}
+
+void GraphRenderer::AddEdge(ImVec2 p0, ImVec2 p1, ImVec2 p2, ImVec2 p3,
+                            float thickness, ImU32 color) {
+  edges.push_back(
+      {p0.x, p0.y, p1.x, p1.y, p2.x, p2.y, p3.x, p3.y, thickness, color});
+}
+
+void GraphRenderer::AddPolyline(const ImVec2* points, size_t count,
+                                float thickness, ImU32 color) {
+  // Catmull-Rom spline through the points, converted to bezier spans.
+  for (size_t i = 0; i + 1 < count; i++) {
+    ImVec2 previous = points[i > 0 ? i - 1 : i];
+    ImVec2 start = points[i];
+    ImVec2 end = points[i + 1];
+    ImVec2 next = points[i + 2 < count ? i + 2 : i + 1];
+    ImVec2 control_start(start.x + (end.x - previous.x) / 6,
+                         start.y + (end.y - previous.y) / 6);
+    ImVec2 control_end(end.x - (next.x - start.x) / 6,
+                       end.y - (next.y - start.y) / 6);
+    AddEdge(start, control_start, control_end, end, thickness, color);
+  }
+}
+
+void GraphRenderer::AddArrow(ImVec2 tip, float direction, ImU32 color) {
+  arrows.push_back({tip.x, tip.y, direction, color});
+}
+
+void GraphRenderer::Submit(ImDrawList* draw_list) {
+  if (nodes.empty() && edges.empty()) return;
+  draw_list->AddCallback(RenderCallback, this);
+  // Hand ImGui's own GL state back for whatever the window draws next.
+  draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void GraphRenderer::RenderCallback(const ImDrawList*, const ImDrawCmd* cmd) {
+  static_cast<GraphRenderer*>(cmd->UserCallbackData)->Render(*cmd);
+}
+
+void GraphRenderer::Render(const ImDrawCmd& cmd) {
+  // Same projection and clipping as ImGui_ImplOpenGL3_RenderDrawData, blending
+  // is already set up by it.
+  const ImDrawData* draw_data = ImGui::GetDrawData();
+  ImVec2 display_pos = draw_data->DisplayPos;
+  ImVec2 display_size = draw_data->DisplaySize;
+  ImVec2 scale = draw_data->FramebufferScale;
+  float L = display_pos.x;
+  float R = display_pos.x + display_size.x;
+  float T = display_pos.y;
+  float B = display_pos.y + display_size.y;
+  const float ortho_projection[4][4] = {
+      {2.0f / (R - L), 0.0f, 0.0f, 0.0f},
+      {0.0f, 2.0f / (T - B), 0.0f, 0.0f},
+      {0.0f, 0.0f, -1.0f, 0.0f},
+      {(R + L) / (L - R), (T + B) / (B - T), 0.0f, 1.0f},
+  };
+
+  int fb_height = static_cast<int>(display_size.y * scale.y);
+  ImVec4 clip = cmd.ClipRect;
+  glScissor(static_cast<int>((clip.x - display_pos.x) * scale.x),
+            static_cast<int>(fb_height - (clip.w - display_pos.y) * scale.y),
+            static_cast<int>((clip.z - clip.x) * scale.x),
+            static_cast<int>((clip.w - clip.y) * scale.y));
+
+  glUseProgram(edge_pipeline.program);
+  glUniformMatrix4fv(edge_pipeline.projection_location, 1, GL_FALSE,
+                     &ortho_projection[0][0]);
+  glUniform1f(glGetUniformLocation(edge_pipeline.program, "Segments"),
+              EDGE_SEGMENTS);
+  glBindVertexArray(edge_pipeline.vertex_array);
+  Upload(edge_pipeline.instance_buffer, edges);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (EDGE_SEGMENTS + 1),
+                        edges.size());
+
+  glUseProgram(arrow_pipeline.program);
+  glUniformMatrix4fv(arrow_pipeline.projection_location, 1, GL_FALSE,
+                     &ortho_projection[0][0]);
+  glBindVertexArray(arrow_pipeline.vertex_array);
+  Upload(arrow_pipeline.instance_buffer, arrows);
+  glDrawArraysInstanced(GL_TRIANGLES, 0, 3, arrows.size());
+
+  glUseProgram(node_pipeline.program);
+  glUniformMatrix4fv(node_pipeline.projection_location, 1, GL_FALSE,
+                     &ortho_projection[0][0]);
+  glBindVertexArray(node_pipeline.vertex_array);
+  Upload(node_pipeline.instance_buffer, nodes);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, nodes.size());
+}
+
+};  // namespace gui
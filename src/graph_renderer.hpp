@@ -0,0 +1,81 @@
+#ifndef GRAPH_RENDERER_HPP
+#define GRAPH_RENDERER_HPP
+
+#include <vector>
+#include "imgui.h"
+
+namespace gui {
+
+// Draws graph nodes and edges with instanced OpenGL draws instead of
+// tessellating them into an ImDrawList on the CPU. Nodes are quads shaded as
+// anti-aliased circles, edges are cubic beziers expanded to triangle strips
+// in the vertex shader, arrow heads are single triangles.
+//
+// Shapes are collected during the frame and drawn by a callback queued with
+// Submit, so they are layered with the rest of the window's ImGui content and
+// clipped to it. Init fails when the context can't do instanced arrays,
+// callers then keep drawing through ImDrawList.
+class GraphRenderer {
+ private:
+  struct NodeInstance {
+    float x, y, radius;
+    ImU32 color;
+  };
+  struct EdgeInstance {
+    float p0_x, p0_y, p1_x, p1_y;
+    float p2_x, p2_y, p3_x, p3_y;
+    float thickness;
+    ImU32 color;
+  };
+  struct ArrowInstance {
+    float tip_x, tip_y, direction;
+    ImU32 color;
+  };
+
+  // One shader program, vertex array and instance buffer per shape.
+  struct Pipeline {
+    unsigned program = 0;
+    unsigned vertex_array = 0;
+    unsigned instance_buffer = 0;
+    int projection_location = -1;
+  };
+
+  bool available = false;
+  Pipeline node_pipeline;
+  Pipeline edge_pipeline;
+  Pipeline arrow_pipeline;
+  std::vector<NodeInstance> nodes;
+  std::vector<EdgeInstance> edges;
+  std::vector<ArrowInstance> arrows;
+
+  static void RenderCallback(const ImDrawList* draw_list, const ImDrawCmd* cmd);
+  void Render(const ImDrawCmd& cmd);
+  void DestroyPipeline(Pipeline& pipeline);
+
+ public:
+  GraphRenderer() = default;
+  GraphRenderer(const GraphRenderer&) = delete;
+  GraphRenderer& operator=(const GraphRenderer&) = delete;
+  ~GraphRenderer();
+
+  // Needs the current GL context, glsl_version is the same string ImGui's
+  // OpenGL binding was initialized with.
+  bool Init(const char* glsl_version);
+  bool Available() const { return available; }
+
+  void Clear();
+  void AddNode(ImVec2 center, float radius, ImU32 color);
+  void AddEdge(ImVec2 p0, ImVec2 p1, ImVec2 p2, ImVec2 p3, float thickness,
+               ImU32 color);
+  // Smooth curve through points, drawn as one bezier instance per span.
+  void AddPolyline(const ImVec2* points, size_t count, float thickness,
+                   ImU32 color);
+  // direction is +1 for an arrow pointing right, -1 for one pointing left.
+  void AddArrow(ImVec2 tip, float direction, ImU32 color);
+  // Queues drawing everything added since Clear at this point of draw_list.
+  void Submit(ImDrawList* draw_list);
+};
+
+};  // namespace gui
+
+#endif  // GRAPH_RENDERER_HPP
@@ -1,16 +1,20 @@
 #include "gui.hpp"
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <numeric>
+#include <sstream>
 #include <string>
 #include <vector>
 #include "TextEditor.h"
 #include "imgui.h"
+#include "fuzzy_match.hpp"
 #include "keyboard.hpp"
 
 // imgui_stdlib.cpp
@@ -127,6 +131,34 @@ static void glfw_error_callback(int error, const char* description) {
   fprintf(stderr, "Glfw Error %d: %s\n", error, description);
 }
 
+// Set by every GLFW input or window callback, cleared before waiting for
+// events. Callbacks only run on the main thread inside glfw*Events.
+static bool input_received = false;
+
+// Registered before ImGui's GLFW binding, which installs its own callbacks and
+// chains to these.
+static void install_input_callbacks(GLFWwindow* window) {
+  glfwSetMouseButtonCallback(
+      window, [](GLFWwindow*, int, int, int) { input_received = true; });
+  glfwSetScrollCallback(
+      window, [](GLFWwindow*, double, double) { input_received = true; });
+  glfwSetKeyCallback(window, [](GLFWwindow*, int, int, int, int) {
+    input_received = true;
+  });
+  glfwSetCharCallback(window,
+                      [](GLFWwindow*, unsigned int) { input_received = true; });
+  glfwSetCursorPosCallback(
+      window, [](GLFWwindow*, double, double) { input_received = true; });
+  glfwSetCursorEnterCallback(
+      window, [](GLFWwindow*, int) { input_received = true; });
+  glfwSetWindowSizeCallback(
+      window, [](GLFWwindow*, int, int) { input_received = true; });
+  glfwSetWindowFocusCallback(
+      window, [](GLFWwindow*, int) { input_received = true; });
+  glfwSetWindowRefreshCallback(window,
+                               [](GLFWwindow*) { input_received = true; });
+}
+
 MainWindow::MainWindow() {
   // Setup window
   glfwSetErrorCallback(glfw_error_callback);
@@ -192,10 +224,25 @@ MainWindow::MainWindow() {
   // ImGui::StyleColorsClassic();
 
   // Setup Platform/Renderer bindings
+  install_input_callbacks(window);
   ImGui_ImplGlfw_InitForOpenGL(window, true);
   ImGui_ImplOpenGL3_Init(glsl_version);
 }
 
+bool MainWindow::PollEvents() {
+  input_received = false;
+  glfwPollEvents();
+  return input_received;
+}
+
+bool MainWindow::WaitEvents(double timeout_seconds) {
+  input_received = false;
+  glfwWaitEventsTimeout(timeout_seconds);
+  return input_received;
+}
+
+void MainWindow::Wake() { glfwPostEmptyEvent(); }
+
 MainWindow::~MainWindow() {
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
@@ -563,49 +610,121 @@ void WindowsToggleMenu::Draw() {
   ImGui::Checkbox("AST dump", &show_ast_dump_window);
   ImGui::SameLine(450);
   ImGui::Checkbox("Function list", &show_function_list_window);
-  ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+  ImGui::SameLine(600);
+  ImGui::Checkbox("Extraction settings", &show_extraction_settings_window);
+  ImGui::SameLine(800);
+  ImGui::Checkbox("Symbol search", &show_symbol_search_window);
+  ImGui::SameLine(950);
+  ImGui::Checkbox("Scopes", &show_scope_tree_window);
+  ImGui::SameLine(1100);
+  ImGui::Checkbox("Metrics", &show_metrics_window);
+  ImGui::Text("Frames rendered: %lu", frames_rendered);
 
   ImGui::End();
 }
 
+void FunctionListFilteringWindow::AddFunctions(
+    const std::vector<clang_interface::FunctionDecl*>& func) {
+  for (auto function : func) {
+    signature_index.Add(function->SignatureAsString());
+    if (filter.PassFilter(function->SignatureAsString().data())) {
+      filtered.push_back(functions.size());
+    }
+    functions.push_back(function);
+  }
+}
+
+void FunctionListFilteringWindow::Refilter() {
+  filtered.clear();
+  // Only names containing one of the included terms can pass, the index
+  // narrows the scan down to those unless a term is too short for it.
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> term_candidates;
+  bool scan_all = true;
+  for (const auto& range : filter.Filters) {
+    if (range.empty() || range.b[0] == '-') continue;
+    std::string_view term(range.b, range.e - range.b);
+    if (!signature_index.Candidates(term, term_candidates)) {
+      scan_all = true;
+      break;
+    }
+    scan_all = false;
+    candidates.insert(candidates.end(), term_candidates.begin(),
+                      term_candidates.end());
+  }
+
+  auto check = [&](uint32_t index) {
+    if (filter.PassFilter(functions[index]->SignatureAsString().data())) {
+      filtered.push_back(index);
+    }
+  };
+  if (scan_all) {
+    for (uint32_t index = 0; index < functions.size(); index++) check(index);
+    return;
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+  for (uint32_t index : candidates) check(index);
+}
+
 void FunctionListFilteringWindow::Draw() {
   ImGui::Begin("Functions Filtering List", &p_open,
                ImGuiWindowFlags_NoCollapse);
   if (ImGui::IsWindowHovered() && !ImGui::IsWindowFocused())
     ImGui::SetWindowFocus();
 
-  filter.Draw();
-
-  if (functions) {
-    for (const auto& function : *functions) {
-      if (filter.PassFilter(function->NameAsString().c_str())) {
-	char idbuffer[16];
-	sprintf(idbuffer, "%u", function->ID());
-	bool open = ImGui::TreeNode(idbuffer, "%s", function->NameAsString().c_str());
-        bool clicked = ImGui::IsItemClicked();
-
-        if (open) {
-          ImGui::Text("Return type: %s",
-                      function->ReturnTypeAsString().c_str());
-          if (function->HasParams()) {
-            ImGui::Text("Params: ");
-            for (auto param = function->ParamBegin();
-                 param != function->ParamEnd(); ++param) {
-              ImGui::Text("\t%s %s", param->TypeAsString().c_str(),
-                          param->NameAsString().c_str());
-            }
-
-          } else {
-            ImGui::Text("Params: None");
-          }
-          ImGui::TreePop();
-        }
-        if (clicked) {
-          last_clicked = function.get();
-        }
+  if (filter.Draw()) {
+    Refilter();
+  }
+
+  // Rows are a single line each so the clipper only submits the visible
+  // ones, details of the last clicked function go into a pane below.
+  ImGui::BeginChild("Functions",
+                    ImVec2(0, -ImGui::GetTextLineHeightWithSpacing() *
+                                  DETAILS_PANE_LINES));
+  ImGuiListClipper clipper(filtered.size());
+  while (clipper.Step()) {
+    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+      const auto function = functions[filtered[row]];
+      ImGui::PushID(row);
+      if (ImGui::Selectable(function->SignatureAsString().data(),
+                            function == last_clicked)) {
+        last_clicked = function;
       }
+      ImGui::PopID();
     }
   }
+  ImGui::EndChild();
+
+  ImGui::Separator();
+  ImGui::BeginChild("Details");
+  if (last_clicked != nullptr) {
+    const auto function = last_clicked;
+    ImGui::Text("Signature: %s", function->SignatureAsString().data());
+    ImGui::Text("Return type: %s", function->ReturnTypeAsString().data());
+    if (function->HasParams()) {
+      ImGui::Text("Params: ");
+      for (auto param = function->ParamBegin();
+           param != function->ParamEnd(); ++param) {
+        ImGui::Text("\t%s %s", param->TypeAsString().data(),
+                    param->NameAsString().data());
+      }
+
+    } else {
+      ImGui::Text("Params: None");
+    }
+    if (ImGui::SmallButton("Callees view")) {
+      view_request = function;
+      view_request_callers = false;
+    }
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Callers view")) {
+      view_request = function;
+      view_request_callers = true;
+    }
+  }
+  ImGui::EndChild();
 
   ImGui::End();
 }
@@ -616,11 +735,452 @@ void FunctionASTDumpWindow::Draw() {
   if (ImGui::IsWindowHovered() && !ImGui::IsWindowFocused())
     ImGui::SetWindowFocus();
   if (function) {
-    ImGui::Text("%s", function->ASTDump().c_str());
+    ImGui::Text("%s", function->ASTDump().data());
   } else {
     ImGui::Text("None");
   }
   ImGui::End();
 }
 
+static std::vector<std::string> split_paths(const std::string& paths) {
+  std::vector<std::string> result;
+  std::stringstream stream(paths);
+  std::string path;
+  while (std::getline(stream, path, ',')) {
+    auto first = path.find_first_not_of(' ');
+    if (first == std::string::npos) continue;
+    auto last = path.find_last_not_of(' ');
+    result.push_back(path.substr(first, last - first + 1));
+  }
+  return result;
+}
+
+void SymbolSearchWindow::AddFunctions(
+    const std::vector<clang_interface::FunctionDecl*>& func) {
+  if (func.empty()) return;
+  auto chunk = std::make_shared<SymbolChunk>();
+  chunk->reserve(func.size());
+  for (auto function : func) {
+    std::string parameter_types;
+    for (auto param = function->ParamBegin(); param != function->ParamEnd();
+         ++param) {
+      if (!parameter_types.empty()) parameter_types += ", ";
+      parameter_types += param->TypeAsString();
+    }
+    chunk->push_back({function, function->NameAsString(),
+                      function->QualifiedNameAsString(),
+                      std::move(parameter_types)});
+  }
+  chunks.push_back(std::move(chunk));
+}
+
+void SymbolSearchWindow::CancelSearch() {
+  if (search_cancelled) *search_cancelled = true;
+  // Waits for the search thread, it stops at the next check
+  search_job = {};
+}
+
+void SymbolSearchWindow::Clear() {
+  CancelSearch();
+  chunks.clear();
+  result = SearchResult();
+  selected = 0;
+  jump_request = nullptr;
+}
+
+bool SymbolSearchWindow::SearchReady() const {
+  return search_job.valid() &&
+         search_job.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready;
+}
+
+SymbolSearchWindow::SearchResult SymbolSearchWindow::Search(
+    std::string query, Chunks chunks, const SearchResult& previous,
+    const std::atomic<bool>& cancelled) {
+  SearchResult found;
+  found.query = std::move(query);
+  found.searched_chunks = chunks.size();
+  auto score = [&found](const Symbol& symbol) {
+    return std::max({fuzzy_match::Score(found.query, symbol.name),
+                     fuzzy_match::Score(found.query, symbol.qualified_name),
+                     fuzzy_match::Score(found.query, symbol.parameter_types)});
+  };
+  auto add = [&found, &score, &chunks](uint32_t chunk, uint32_t index) {
+    int symbol_score = score((*chunks[chunk])[index]);
+    if (symbol_score != fuzzy_match::NO_MATCH) {
+      found.matches.push_back({chunk, index, symbol_score});
+    }
+  };
+
+  // Whatever matches a query also matches every prefix of it, so a grown
+  // query only rescores the previous matches and the chunks added since.
+  size_t first_chunk = 0;
+  if (!previous.query.empty() &&
+      found.query.compare(0, previous.query.size(), previous.query) == 0) {
+    for (size_t i = 0; i < previous.matches.size(); i++) {
+      if (i % 4096 == 0 && cancelled) {
+        found.complete = false;
+        return found;
+      }
+      add(previous.matches[i].chunk, previous.matches[i].index);
+    }
+    first_chunk = previous.searched_chunks;
+  }
+  for (size_t chunk = first_chunk; chunk < chunks.size(); chunk++) {
+    for (size_t index = 0; index < chunks[chunk]->size(); index++) {
+      if (index % 4096 == 0 && cancelled) {
+        found.complete = false;
+        return found;
+      }
+      add(chunk, index);
+    }
+  }
+
+  auto ranked = found.matches.begin() +
+                std::min(RANKED_MATCHES, found.matches.size());
+  std::partial_sort(found.matches.begin(), ranked, found.matches.end(),
+                    [](const Match& a, const Match& b) {
+                      if (a.score != b.score) return a.score > b.score;
+                      return a.chunk != b.chunk ? a.chunk < b.chunk
+                                                : a.index < b.index;
+                    });
+  return found;
+}
+
+void SymbolSearchWindow::UpdateSearch() {
+  if (SearchReady()) {
+    auto finished = search_job.get();
+    if (finished.complete) result = std::move(finished);
+  }
+  if (search_job.valid() ||
+      (result.query == query && result.searched_chunks == chunks.size()))
+    return;
+  if (query.empty()) {
+    result = SearchResult();
+    result.searched_chunks = chunks.size();
+    return;
+  }
+
+  search_cancelled = std::make_shared<std::atomic<bool>>(false);
+  search_job = std::async(std::launch::async,
+                          [query = query, chunks = chunks, previous = result,
+                           cancelled = search_cancelled] {
+                            auto found = Search(query, chunks, previous,
+                                                *cancelled);
+                            MainWindow::Wake();
+                            return found;
+                          });
+}
+
+void SymbolSearchWindow::Draw() {
+  UpdateSearch();
+
+  ImGui::Begin("Symbol Search", &p_open, ImGuiWindowFlags_NoCollapse);
+  if (ImGui::IsWindowHovered() && !ImGui::IsWindowFocused())
+    ImGui::SetWindowFocus();
+
+  if (ImGui::InputText("Symbol", &query)) {
+    selected = 0;
+    // The next UpdateSearch starts over with the new query
+    if (search_cancelled) *search_cancelled = true;
+  }
+
+  int ranked = std::min(RANKED_MATCHES, result.matches.size());
+  selected = std::max(std::min(selected, ranked - 1), 0);
+  auto symbol = [this](const Match& match) -> const Symbol& {
+    return (*chunks[match.chunk])[match.index];
+  };
+  if (ranked > 0 &&
+      ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows)) {
+    if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+      selected = std::min(selected + 1, ranked - 1);
+    if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+      selected = std::max(selected - 1, 0);
+    if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Enter)))
+      jump_request = symbol(result.matches[selected]).function;
+  }
+
+  if (search_job.valid()) {
+    ImGui::Text("Searching...");
+  } else {
+    ImGui::Text("%zu matches", result.matches.size());
+  }
+
+  ImGui::BeginChild("Matches");
+  for (int i = 0; i < ranked; i++) {
+    const Symbol& match = symbol(result.matches[i]);
+    ImGui::PushID(i);
+    if (ImGui::Selectable(match.function->SignatureAsString().data(),
+                          i == selected)) {
+      selected = i;
+      jump_request = match.function;
+    }
+    ImGui::PopID();
+  }
+  ImGui::EndChild();
+
+  ImGui::End();
+}
+
+void ScopeTreeWindow::AddFunctions(
+    const std::vector<clang_interface::FunctionDecl*>& func) {
+  for (auto function : func) {
+    std::string_view path = function->ScopeAsString();
+    size_t current = 0;
+    scopes[current].functions++;
+    if (path.empty()) continue;
+    // Split at "::" outside of template arguments and parentheses, as in
+    // "ns::Map<a::b>::(anonymous namespace)".
+    size_t component_start = 0;
+    int nesting = 0;
+    for (size_t i = 0; i <= path.size(); i++) {
+      if (i < path.size()) {
+        char c = path[i];
+        if (c == '<' || c == '(') nesting++;
+        if ((c == '>' || c == ')') && nesting > 0) nesting--;
+        if (nesting > 0 || c != ':' || i + 1 >= path.size() ||
+            path[i + 1] != ':')
+          continue;
+      }
+      std::string_view name =
+          path.substr(component_start, i - component_start);
+      auto child = scopes[current].children.find(name);
+      if (child == scopes[current].children.end()) {
+        Scope scope;
+        scope.path = string_pool::Intern(path.substr(0, i));
+        scope.name = scope.path.substr(component_start);
+        scopes[current].children.emplace(scope.name, scopes.size());
+        scopes.push_back(std::move(scope));
+        current = scopes.size() - 1;
+      } else {
+        current = child->second;
+      }
+      scopes[current].functions++;
+      component_start = i + 2;
+      i++;
+    }
+  }
+}
+
+void ScopeTreeWindow::DrawScope(size_t scope) {
+  ImGui::PushID(scope);
+  bool checked = collapsed.count(scopes[scope].path) > 0;
+  if (ImGui::Checkbox("##collapse", &checked)) {
+    if (checked) {
+      collapsed.emplace(scopes[scope].path);
+    } else {
+      collapsed.erase(collapsed.find(scopes[scope].path));
+    }
+    changed = true;
+  }
+  ImGui::SameLine();
+  bool open = ImGui::TreeNodeEx(
+      "scope",
+      scopes[scope].children.empty() ? ImGuiTreeNodeFlags_Leaf : 0,
+      "%.*s (%zu)", static_cast<int>(scopes[scope].name.size()),
+      scopes[scope].name.data(), scopes[scope].functions);
+  if (open) {
+    for (const auto& child : scopes[scope].children) DrawScope(child.second);
+    ImGui::TreePop();
+  }
+  ImGui::PopID();
+}
+
+void ScopeTreeWindow::Draw() {
+  ImGui::Begin("Scopes", &p_open, ImGuiWindowFlags_NoCollapse);
+  if (ImGui::IsWindowHovered() && !ImGui::IsWindowFocused())
+    ImGui::SetWindowFocus();
+
+  ImGui::Text("Checked scopes are drawn as one node in the call graph.");
+  ImGui::Separator();
+  if (scopes[0].children.empty()) {
+    ImGui::Text("No namespaces or classes");
+  }
+  for (const auto& child : scopes[0].children) DrawScope(child.second);
+
+  ImGui::End();
+}
+
+void MetricsWindow::AddBatch(const clang_interface::CallGraphBatch& batch) {
+  for (auto function : batch.nodes) {
+    index_by_id[function->ID()] = functions.size();
+    functions.push_back(function);
+  }
+  for (const auto& [caller, callee] : batch.edges) {
+    edges.push_back(
+        {index_by_id.at(caller->ID()), index_by_id.at(callee->ID())});
+  }
+}
+
+void MetricsWindow::CancelMetrics() {
+  if (metrics_cancelled) *metrics_cancelled = true;
+  // Waits for the metrics thread, it stops at the next check
+  metrics_job = {};
+}
+
+void MetricsWindow::Clear() {
+  CancelMetrics();
+  functions.clear();
+  index_by_id.clear();
+  edges.clear();
+  computed_functions = 0;
+  computed_edges = 0;
+  metrics = graph_metrics::Metrics();
+  rows.clear();
+  jump_request = nullptr;
+}
+
+bool MetricsWindow::MetricsReady() const {
+  return metrics_job.valid() &&
+         metrics_job.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready;
+}
+
+void MetricsWindow::SortRows() {
+  auto key = [this](uint32_t row) -> double {
+    switch (sort_column) {
+      case Column::FanIn: return metrics.fan_in[row];
+      case Column::FanOut: return metrics.fan_out[row];
+      case Column::Depth: return metrics.depth[row];
+      case Column::PageRank: return metrics.pagerank[row];
+      case Column::Betweenness: return metrics.betweenness[row];
+      case Column::Name: break;
+    }
+    return 0;
+  };
+  auto before = [&](uint32_t a, uint32_t b) {
+    if (sort_column == Column::Name) {
+      return functions[a]->SignatureAsString() <
+             functions[b]->SignatureAsString();
+    }
+    return key(a) < key(b);
+  };
+  std::stable_sort(rows.begin(), rows.end(), [&](uint32_t a, uint32_t b) {
+    return sort_descending ? before(b, a) : before(a, b);
+  });
+}
+
+void MetricsWindow::Draw(bool graph_complete) {
+  if (MetricsReady()) {
+    auto computed = metrics_job.get();
+    if (computed.complete) {
+      metrics = std::move(computed);
+      rows.resize(metrics.fan_in.size());
+      std::iota(rows.begin(), rows.end(), 0);
+      SortRows();
+    }
+  }
+  bool outdated = computed_functions != functions.size() ||
+                  computed_edges != edges.size();
+  if (graph_complete && outdated && !metrics_job.valid()) {
+    computed_functions = functions.size();
+    computed_edges = edges.size();
+    metrics_cancelled = std::make_shared<std::atomic<bool>>(false);
+    metrics_job = std::async(
+        std::launch::async,
+        [graph = graph_metrics::FromEdges(functions.size(), edges),
+         cancelled = metrics_cancelled] {
+          auto computed = graph_metrics::Compute(graph, {}, *cancelled);
+          MainWindow::Wake();
+          return computed;
+        });
+  }
+
+  ImGui::Begin("Graph Metrics", &p_open, ImGuiWindowFlags_NoCollapse);
+  if (ImGui::IsWindowHovered() && !ImGui::IsWindowFocused())
+    ImGui::SetWindowFocus();
+
+  if (metrics_job.valid()) {
+    ImGui::Text("Computing metrics of %zu functions...", computed_functions);
+  } else if (!graph_complete) {
+    ImGui::Text("Waiting for the extraction to finish");
+  } else {
+    ImGui::Text("%zu functions, %zu calls%s", rows.size(), edges.size(),
+                metrics.betweenness_sampled ? ", betweenness is sampled" : "");
+  }
+
+  static const char* headers[COLUMN_COUNT] = {
+      "Function", "Fan-in", "Fan-out", "Depth", "PageRank", "Betweenness"};
+  const float number_width = 90;
+  auto set_widths = [&] {
+    float name_width = std::max(
+        100.f, ImGui::GetWindowContentRegionWidth() -
+                   number_width * (COLUMN_COUNT - 1));
+    ImGui::SetColumnWidth(0, name_width);
+    for (int column = 1; column < COLUMN_COUNT; column++)
+      ImGui::SetColumnWidth(column, number_width);
+  };
+
+  // Clicking a header sorts by it, clicking it again flips the order
+  ImGui::Columns(COLUMN_COUNT, "MetricsHeader");
+  set_widths();
+  for (int column = 0; column < COLUMN_COUNT; column++) {
+    bool sorted = static_cast<int>(sort_column) == column;
+    char label[32];
+    snprintf(label, sizeof(label), "%s %s", headers[column],
+             sorted ? (sort_descending ? "v" : "^") : "");
+    if (ImGui::Selectable(label, sorted)) {
+      sort_descending = sorted ? !sort_descending : column != 0;
+      sort_column = static_cast<Column>(column);
+      SortRows();
+    }
+    ImGui::NextColumn();
+  }
+  ImGui::Columns(1);
+  ImGui::Separator();
+
+  ImGui::BeginChild("MetricsRows");
+  ImGui::Columns(COLUMN_COUNT, "MetricsRows", false);
+  set_widths();
+  ImGuiListClipper clipper(rows.size());
+  while (clipper.Step()) {
+    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+      uint32_t row = rows[i];
+      ImGui::PushID(i);
+      if (ImGui::Selectable(functions[row]->SignatureAsString().data(), false,
+                            ImGuiSelectableFlags_SpanAllColumns)) {
+        jump_request = functions[row];
+      }
+      ImGui::NextColumn();
+      ImGui::Text("%u", metrics.fan_in[row]);
+      ImGui::NextColumn();
+      ImGui::Text("%u", metrics.fan_out[row]);
+      ImGui::NextColumn();
+      ImGui::Text("%u", metrics.depth[row]);
+      ImGui::NextColumn();
+      ImGui::Text("%.5f", metrics.pagerank[row]);
+      ImGui::NextColumn();
+      ImGui::Text("%.1f", metrics.betweenness[row]);
+      ImGui::NextColumn();
+      ImGui::PopID();
+    }
+  }
+  ImGui::Columns(1);
+  ImGui::EndChild();
+
+  ImGui::End();
+}
+
+void ExtractionSettingsWindow::Draw() {
+  ImGui::Begin("Extraction Settings", &p_open, ImGuiWindowFlags_NoCollapse);
+  if (ImGui::IsWindowHovered() && !ImGui::IsWindowFocused())
+    ImGui::SetWindowFocus();
+
+  ImGui::Checkbox("Skip system headers", &skip_system_headers);
+  ImGui::Checkbox("Skip function bodies outside the selected files",
+                  &skip_function_bodies);
+  ImGui::InputText("Include paths", &include_paths);
+  ImGui::InputText("Exclude paths", &exclude_paths);
+  ImGui::Text("Comma separated path prefixes, the opened file is always used.");
+  if (ImGui::Button("Apply")) {
+    options.skip_system_headers = skip_system_headers;
+    options.skip_function_bodies = skip_function_bodies;
+    options.include_paths = split_paths(include_paths);
+    options.exclude_paths = split_paths(exclude_paths);
+    changed = true;
+  }
+
+  ImGui::End();
+}
+
 };  // namespace gui
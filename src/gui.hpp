@@ -1,12 +1,23 @@
 #ifndef GUI_HPP
 #define GUI_HPP
 
+#include <atomic>
 #include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "TextEditor.h"
 #include "clang_interface.h"
+#include "graph_metrics.hpp"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "trigram_index.hpp"
 
 namespace fs = std::filesystem;
 
@@ -48,6 +59,16 @@ class MainWindow {
 
  public:
   GLFWwindow* Window() { return window; }
+  const char* GlslVersion() const { return glsl_version; }
+
+  // Process pending events, return whether any of them was user input or a
+  // window change that needs a redraw.
+  bool PollEvents();
+  // Like PollEvents, but sleeps until an event arrives, Wake is called or
+  // the timeout passes.
+  bool WaitEvents(double timeout_seconds);
+  // Interrupts WaitEvents, callable from any thread.
+  static void Wake();
 
   MainWindow();
 
@@ -108,25 +129,52 @@ class WindowsToggleMenu {
   bool show_callgraph_window = true;
   bool show_ast_dump_window = false;
   bool show_function_list_window = false;
+  bool show_extraction_settings_window = false;
+  bool show_symbol_search_window = false;
+  bool show_scope_tree_window = false;
+  bool show_metrics_window = false;
+  unsigned long frames_rendered = 0;
 
   void Draw();
 };
 
 class FunctionListFilteringWindow {
  private:
+  static constexpr float DETAILS_PANE_LINES = 8;
+
   ImGuiTextFilter filter;
-  const clang_interface::CallGraph::NodesList* functions{nullptr};
+  std::vector<clang_interface::FunctionDecl*> functions;
+  TrigramIndex signature_index;
+  // Positions in functions passing the filter, only rebuilt when the filter
+  // text changes.
+  std::vector<uint32_t> filtered;
   clang_interface::FunctionDecl* last_clicked{nullptr};
+  clang_interface::FunctionDecl* view_request{nullptr};
+  bool view_request_callers = false;
   bool& p_open;
 
+  void Refilter();
+
  public:
   explicit FunctionListFilteringWindow(bool& p_open) : p_open(p_open) {}
   clang_interface::FunctionDecl* LastClickedFunction() const {
     return last_clicked;
   }
-  void SetFunctionsList(const clang_interface::CallGraph::NodesList* func) {
-    functions = func;
+  // A function whose callers or callees should get a graph view of their
+  // own, returns false when none was requested since the last call.
+  bool PopViewRequest(clang_interface::FunctionDecl*& root, bool& callers) {
+    if (view_request == nullptr) return false;
+    root = std::exchange(view_request, nullptr);
+    callers = view_request_callers;
+    return true;
+  }
+  void AddFunctions(const std::vector<clang_interface::FunctionDecl*>& func);
+  void Clear() {
+    functions.clear();
+    signature_index.Clear();
+    filtered.clear();
     last_clicked = nullptr;
+    view_request = nullptr;
   }
   void Draw();
 };
@@ -143,6 +191,162 @@ class FunctionASTDumpWindow {
   void Draw();
 };
 
+// Fuzzy "go to symbol" search over function names, qualified names and
+// parameter types. Matching runs on a background thread. When the query
+// only grows, the next search rescores the previous matches instead of every
+// symbol, so typing stays responsive on large graphs.
+class SymbolSearchWindow {
+ private:
+  static constexpr size_t RANKED_MATCHES = 100;
+
+  // The searched texts, copied so the search thread never touches the
+  // FunctionDecl objects the extraction worker may release.
+  struct Symbol {
+    clang_interface::FunctionDecl* function;
+    std::string_view name;
+    std::string_view qualified_name;
+    std::string parameter_types;
+  };
+  // Symbols are added in immutable chunks, a search shares the chunks that
+  // existed when it started.
+  using SymbolChunk = std::vector<Symbol>;
+  using Chunks = std::vector<std::shared_ptr<const SymbolChunk>>;
+  struct Match {
+    uint32_t chunk;
+    uint32_t index;
+    int score;
+  };
+  struct SearchResult {
+    std::string query;
+    size_t searched_chunks = 0;
+    bool complete = true;
+    // Every match, the best RANKED_MATCHES of them first and sorted
+    std::vector<Match> matches;
+  };
+
+  std::string query;
+  Chunks chunks;
+  SearchResult result;
+  std::shared_ptr<std::atomic<bool>> search_cancelled;
+  std::future<SearchResult> search_job;
+  int selected = 0;
+  clang_interface::FunctionDecl* jump_request{nullptr};
+  bool& p_open;
+
+  static SearchResult Search(std::string query, Chunks chunks,
+                             const SearchResult& previous,
+                             const std::atomic<bool>& cancelled);
+  void CancelSearch();
+  bool SearchReady() const;
+  void UpdateSearch();
+
+ public:
+  explicit SymbolSearchWindow(bool& p_open) : p_open(p_open) {}
+  ~SymbolSearchWindow() { CancelSearch(); }
+  void AddFunctions(const std::vector<clang_interface::FunctionDecl*>& func);
+  void Clear();
+  // True when a search finished that the next frame should show. A hidden
+  // window collects the result once it is drawn again.
+  bool HasPendingResults() const { return p_open && SearchReady(); }
+  // The function picked since the last call, nullptr when there is none.
+  clang_interface::FunctionDecl* PopJumpRequest() {
+    return std::exchange(jump_request, nullptr);
+  }
+  void Draw();
+};
+
+// Namespaces and classes of the extracted functions as a tree. Checked
+// scopes are collapsed into a single node in the call graph; the checked set
+// is kept across rebuilds.
+class ScopeTreeWindow {
+ private:
+  struct Scope {
+    std::string_view path;  // interned, "ns::Class"
+    std::string_view name;  // last component of path
+    std::map<std::string_view, size_t> children;
+    size_t functions = 0;  // including nested scopes
+  };
+  // scopes[0] is the file scope
+  std::vector<Scope> scopes;
+  std::set<std::string, std::less<>> collapsed;
+  bool changed = false;
+  bool& p_open;
+
+  void DrawScope(size_t scope);
+
+ public:
+  explicit ScopeTreeWindow(bool& p_open) : scopes(1), p_open(p_open) {}
+  void AddFunctions(const std::vector<clang_interface::FunctionDecl*>& func);
+  void Clear() { scopes.assign(1, Scope()); }
+  std::vector<std::string> CollapsedScopes() const {
+    return std::vector<std::string>(collapsed.begin(), collapsed.end());
+  }
+  bool CollapsedChanged() const { return changed; }
+  void CollapsedApplied() { changed = false; }
+  void Draw();
+};
+
+// Table of graph_metrics per function, sortable by every column. The
+// metrics are computed on a background thread once the graph is complete.
+class MetricsWindow {
+ private:
+  enum class Column { Name, FanIn, FanOut, Depth, PageRank, Betweenness };
+  static constexpr int COLUMN_COUNT = 6;
+
+  std::vector<clang_interface::FunctionDecl*> functions;
+  std::unordered_map<unsigned, uint32_t> index_by_id;
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  // Size of the graph the current metrics or the running job belong to
+  size_t computed_functions = 0;
+  size_t computed_edges = 0;
+  graph_metrics::Metrics metrics;
+  std::shared_ptr<std::atomic<bool>> metrics_cancelled;
+  std::future<graph_metrics::Metrics> metrics_job;
+  // Rows in display order
+  std::vector<uint32_t> rows;
+  Column sort_column = Column::PageRank;
+  bool sort_descending = true;
+  clang_interface::FunctionDecl* jump_request{nullptr};
+  bool& p_open;
+
+  void CancelMetrics();
+  bool MetricsReady() const;
+  void SortRows();
+
+ public:
+  explicit MetricsWindow(bool& p_open) : p_open(p_open) {}
+  ~MetricsWindow() { CancelMetrics(); }
+  void AddBatch(const clang_interface::CallGraphBatch& batch);
+  void Clear();
+  // True when metrics finished computing that the next frame should show.
+  // A hidden window collects them once it is drawn again.
+  bool HasPendingResults() const { return p_open && MetricsReady(); }
+  // The function picked since the last call, nullptr when there is none.
+  clang_interface::FunctionDecl* PopJumpRequest() {
+    return std::exchange(jump_request, nullptr);
+  }
+  // Starts computing once graph_complete is set and the graph changed.
+  void Draw(bool graph_complete);
+};
+
+class ExtractionSettingsWindow {
+ private:
+  clang_interface::ExtractionOptions options;
+  std::string include_paths;
+  std::string exclude_paths;
+  bool skip_system_headers = true;
+  bool skip_function_bodies = false;
+  bool changed = false;
+  bool& p_open;
+
+ public:
+  explicit ExtractionSettingsWindow(bool& p_open) : p_open(p_open) {}
+  const clang_interface::ExtractionOptions& Options() const { return options; }
+  bool OptionsChanged() const { return changed; }
+  void OptionsApplied() { changed = false; }
+  void Draw();
+};
+
 };  // namespace gui
 
 #endif  // GUI_HPP
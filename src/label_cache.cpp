@@ -0,0 +1,107 @@
+#include "label_cache.hpp"
+
+#include <algorithm>
+#include "imgui_internal.h"
+
+namespace gui {
+
+namespace {
+
+// Labels are UTF-8, every byte but a continuation byte starts a glyph.
+bool StartsCodePoint(char byte) { return (byte & 0xC0) != 0x80; }
+
+size_t CodePointCount(std::string_view text) {
+  return std::count_if(text.begin(), text.end(), StartsCodePoint);
+}
+
+// The first count code points of text.
+std::string_view CodePointPrefix(std::string_view text, size_t count) {
+  size_t end = 0;
+  for (; end < text.size(); end++) {
+    if (StartsCodePoint(text[end]) && count-- == 0) break;
+  }
+  return text.substr(0, end);
+}
+
+}  // namespace
+
+void LabelCache::Prepare(ImFont* new_font, float new_font_size,
+                         float max_width) {
+  // Labels use a monospaced font, so the width maps to a character count
+  float char_width = new_font->GetCharAdvance('M') *
+                     (new_font_size / new_font->FontSize);
+  int new_max_chars = std::max(0, static_cast<int>(max_width / char_width));
+  if (new_font != font || new_font_size != font_size ||
+      new_max_chars != max_chars) {
+    Clear();
+    font = new_font;
+    font_size = new_font_size;
+    max_chars = new_max_chars;
+  }
+}
+
+void LabelCache::Clear() {
+  run_offset.clear();
+  run_length.clear();
+  quads.clear();
+}
+
+void LabelCache::Build(size_t label, std::string_view text) {
+  const char* ellipsis = nullptr;
+  if (CodePointCount(text) > static_cast<size_t>(max_chars)) {
+    if (max_chars > 2) {
+      text = CodePointPrefix(text, max_chars - 2);
+      ellipsis = "..";
+    } else {
+      text = CodePointPrefix(text, max_chars);
+    }
+  }
+
+  float scale = font_size / font->FontSize;
+  float x = 0;
+  uint32_t offset = quads.size();
+  auto add_text = [&](const char* begin, const char* end) {
+    while (begin < end) {
+      unsigned int c = *begin;
+      if (c < 0x80)
+        begin++;
+      else
+        begin += ImTextCharFromUtf8(&c, begin, end);
+      const ImFontGlyph* glyph = font->FindGlyph(static_cast<ImWchar>(c));
+      if (glyph == nullptr) continue;
+      if (glyph->X1 > glyph->X0)
+        quads.push_back({ImVec2(x + glyph->X0 * scale, glyph->Y0 * scale),
+                         ImVec2(x + glyph->X1 * scale, glyph->Y1 * scale),
+                         ImVec2(glyph->U0, glyph->V0),
+                         ImVec2(glyph->U1, glyph->V1)});
+      x += glyph->AdvanceX * scale;
+    }
+  };
+  add_text(text.data(), text.data() + text.size());
+  if (ellipsis) add_text(ellipsis, ellipsis + 2);
+
+  run_offset[label] = offset;
+  run_length[label] = quads.size() - offset;
+}
+
+void LabelCache::Draw(ImDrawList* draw_list, size_t label,
+                      std::string_view text, ImVec2 position, ImU32 color) {
+  if (label >= run_offset.size()) {
+    run_offset.resize(label + 1, NOT_BUILT);
+    run_length.resize(label + 1, 0);
+  }
+  if (run_offset[label] == NOT_BUILT) Build(label, text);
+
+  uint16_t count = run_length[label];
+  if (count == 0) return;
+  const GlyphQuad* run = &quads[run_offset[label]];
+  draw_list->PrimReserve(count * 6, count * 4);
+  for (uint16_t i = 0; i < count; i++) {
+    draw_list->PrimRectUV(
+        ImVec2(position.x + run[i].min.x, position.y + run[i].min.y),
+        ImVec2(position.x + run[i].max.x, position.y + run[i].max.y),
+        run[i].uv_min, run[i].uv_max, color);
+  }
+}
+
+};  // namespace gui
@@ -0,0 +1,46 @@
+#ifndef LABEL_CACHE_HPP
+#define LABEL_CACHE_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "imgui.h"
+
+namespace gui {
+
+// Node labels laid out once into glyph quads relative to the label's top
+// left corner. Drawing a label copies its quads into the draw list instead
+// of decoding, looking up and measuring every character again each frame.
+//
+// How much of a name fits depends on the zoom, so runs are cached for one
+// label width at a time. Names longer than the width are cut and end with
+// "..", when zoomed in far enough the full name is shown.
+class LabelCache {
+ private:
+  struct GlyphQuad {
+    ImVec2 min, max;
+    ImVec2 uv_min, uv_max;
+  };
+  static constexpr uint32_t NOT_BUILT = ~0u;
+
+  ImFont* font = nullptr;
+  float font_size = 0;
+  int max_chars = 0;
+  std::vector<uint32_t> run_offset;
+  std::vector<uint16_t> run_length;
+  std::vector<GlyphQuad> quads;
+
+  void Build(size_t label, std::string_view text);
+
+ public:
+  // Starts a frame, drops every run when the font changed or the width
+  // allows a different number of characters than before.
+  void Prepare(ImFont* new_font, float new_font_size, float max_width);
+  void Clear();
+  void Draw(ImDrawList* draw_list, size_t label, std::string_view text,
+            ImVec2 position, ImU32 color);
+};
+
+};  // namespace gui
+
+#endif  // LABEL_CACHE_HPP
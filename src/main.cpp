@@ -8,19 +8,61 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "aggregation.hpp"
 #include "clang_interface.h"
+#include "extraction_worker.hpp"
 #include "graph.hpp"
 #include "gui.hpp"
 #include "keyboard.hpp"
 
+// Time per frame spent merging extracted batches into the GUI.
+constexpr auto BATCH_MERGE_BUDGET = std::chrono::milliseconds(4);
+
+// ImGui needs a few frames after an input to settle hover and window state.
+constexpr int FRAMES_AFTER_INPUT = 3;
+// How often an idle window wakes up to check the pending rebuild timer.
+constexpr double IDLE_WAIT_TIMEOUT_SECONDS = 0.25;
+
+// Held keys scroll the graph and held buttons drag, both keep animating
+// without producing new events.
+static bool IsInputHeld(const ImGuiIO& io) {
+  for (bool down : io.KeysDown)
+    if (down) return true;
+  for (bool down : io.MouseDown)
+    if (down) return true;
+  return false;
+}
+
+// Graph window opened from the function list, rooted at one function and
+// showing either its callees or its callers.
+struct PinnedGraphView {
+  bool open = true;
+  clang_interface::FunctionDecl* root;
+  gui::GraphGui graph;
+
+  PinnedGraphView(ImGuiIO* io, TextEditor* editor,
+                  clang_interface::FunctionDecl* root, bool callers, int id)
+      : root(root),
+        graph(io, editor, open,
+              std::string(callers ? "Callers of " : "Callees of ") +
+                  std::string(root->NameAsString()) + "##view" +
+                  std::to_string(id),
+              callers ? gui::GraphDirection::Callers
+                      : gui::GraphDirection::Callees) {}
+};
+
 int main(int, char**) {
   gui::MainWindow main_window;
   ImGuiIO& io = ImGui::GetIO();
@@ -34,18 +76,88 @@ int main(int, char**) {
   gui::SourceCodePanel source_code_panel(
       io, main_window, &windows_toggle_menu.show_source_code_window);
 
-  clang_interface::ASTUnit ast_unit;
-  clang_interface::CallGraph call_graph;
+  clang_interface::ExtractionWorker extraction_worker(gui::MainWindow::Wake);
+  clang_interface::CallGraphBatch batch;
   gui::FunctionListFilteringWindow functions_filtering_window(
       windows_toggle_menu.show_function_list_window);
 
   gui::FunctionASTDumpWindow function_ast_dump_window(
       windows_toggle_menu.show_ast_dump_window);
 
+  gui::ExtractionSettingsWindow extraction_settings_window(
+      windows_toggle_menu.show_extraction_settings_window);
+
+  gui::SymbolSearchWindow symbol_search_window(
+      windows_toggle_menu.show_symbol_search_window);
+
+  gui::ScopeTreeWindow scope_tree_window(
+      windows_toggle_menu.show_scope_tree_window);
+
+  gui::MetricsWindow metrics_window(windows_toggle_menu.show_metrics_window);
+
   gui::GraphGui graph(&io, &source_code_panel.Editor(),
                       windows_toggle_menu.show_callgraph_window);
+  graph.init_renderer(main_window.GlslVersion());
+  std::vector<std::unique_ptr<PinnedGraphView>> pinned_views;
+  int pinned_views_opened = 0;
+  // Everything extracted so far, a view opened mid-stream starts from it.
+  clang_interface::CallGraphBatch extracted;
+  auto any_view = [&](auto predicate) {
+    if (predicate(graph)) return true;
+    for (auto& view : pinned_views)
+      if (predicate(view->graph)) return true;
+    return false;
+  };
+  auto each_view = [&](auto function) {
+    function(graph);
+    for (auto& view : pinned_views) function(view->graph);
+  };
+  aggregation::Cache aggregates;
+  // Aggregated views skip batches and are reloaded once extraction is done.
+  bool aggregates_stale = false;
+  // Set while the views show a previous call graph that the one being
+  // extracted replaces once it is complete.
+  bool diff_pending = false;
+  // Jump from the symbol search or metrics window, held back while a diff
+  // is pending.
+  clang_interface::FunctionDecl* focus_request = nullptr;
+  // Starts a view over from the nodes and edges extracted so far, after its
+  // grouping or aggregation level changed.
+  auto reload = [&](gui::GraphGui& view) {
+    view.Clear();
+    view.set_collapsed_scopes(scope_tree_window.CollapsedScopes());
+    if (view.aggregation_level() == aggregation::Level::Functions) {
+      view.MergeBatch(extracted);
+      view.FinishMerge();
+    } else {
+      view.load_aggregate(aggregates.Get(extracted, view.aggregation_level()));
+    }
+    view.aggregation_applied();
+  };
+  int frames_to_render = FRAMES_AFTER_INPUT;
   while (!glfwWindowShouldClose(main_window.Window())) {
-    glfwPollEvents();
+    // Render continuously only while something changes on its own, otherwise
+    // sleep until input arrives or the extraction worker wakes us up.
+    bool animating =
+        extraction_worker.IsExtracting() || IsInputHeld(io) ||
+        any_view([](const gui::GraphGui& view) { return view.is_animating(); });
+    bool input = frames_to_render > 0 || animating
+                     ? main_window.PollEvents()
+                     : main_window.WaitEvents(IDLE_WAIT_TIMEOUT_SECONDS);
+    if (input || animating || symbol_search_window.HasPendingResults() ||
+        metrics_window.HasPendingResults() ||
+        any_view([](const gui::GraphGui& view) {
+          return view.has_pending_results();
+        })) {
+      frames_to_render = FRAMES_AFTER_INPUT;
+    }
+    if (frames_to_render == 0 && !extraction_worker.IsExtracting() &&
+        !source_code_panel.ShouldBuildCallgraph()) {
+      continue;
+    }
+    if (frames_to_render > 0) {
+      frames_to_render--;
+    }
 
     // Start the Dear ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
@@ -54,23 +166,87 @@ int main(int, char**) {
 
     windows_toggle_menu.Draw();
 
-    if (io.KeyShift && io.KeyCtrl && io.KeysDown[keyboard::FKey]) {
-      graph.focus_node(source_code_panel.Editor().GetSelectedText());
+    if (io.KeyShift && io.KeyCtrl &&
+        ImGui::IsKeyPressed(keyboard::FKey, false)) {
+      auto selected = source_code_panel.Editor().GetSelectedText();
+      graph.focus_node(selected);
+      for (auto& view : pinned_views) view->graph.focus_node(selected);
     }
 
-    if (source_code_panel.SecondsSinceLastTextChange() == 1 &&
-        source_code_panel.ShouldBuildCallgraph()) {
+    if ((source_code_panel.SecondsSinceLastTextChange() == 1 &&
+         source_code_panel.ShouldBuildCallgraph()) ||
+        extraction_settings_window.OptionsChanged()) {
+      // The windows start over with the new call graph. The views keep
+      // showing the previous one until the new graph is complete and then
+      // apply the difference, the worker holds on to the previous graph
+      // until then.
       function_ast_dump_window.Clear();
+      functions_filtering_window.Clear();
+      symbol_search_window.Clear();
+      scope_tree_window.Clear();
+      metrics_window.Clear();
+      focus_request = nullptr;
+      diff_pending = diff_pending || !extracted.nodes.empty();
+      extracted = clang_interface::CallGraphBatch();
+      aggregates.Clear();
       std::string compiler_include_dir =
           "-I" + source_code_panel.DirectoryOfLastOpenedFile().string();
-      auto new_ast_unit = clang_interface::BuildASTFromSource(
-          source_code_panel.SourceCode(), {compiler_include_dir});
-      call_graph = clang_interface::ExtractCallGraphFromAST(new_ast_unit);
-      ast_unit = std::move(new_ast_unit);
-      graph.BuildCallGraph(call_graph);
+      extraction_worker.Start(source_code_panel.SourceCode(),
+                              {compiler_include_dir},
+                              extraction_settings_window.Options());
+      if (!diff_pending) extraction_worker.ReleasePrevious();
       source_code_panel.CallGraphBuilt();
-      functions_filtering_window.SetFunctionsList(&call_graph.nodes);
+      extraction_settings_window.OptionsApplied();
+    }
+
+    auto merge_start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - merge_start <
+               BATCH_MERGE_BUDGET &&
+           extraction_worker.TryPopBatch(batch)) {
+      each_view([&](gui::GraphGui& view) {
+        if (diff_pending) return;
+        if (view.aggregation_level() == aggregation::Level::Functions) {
+          view.MergeBatch(batch);
+        } else {
+          aggregates_stale = true;
+        }
+      });
+      functions_filtering_window.AddFunctions(batch.nodes);
+      symbol_search_window.AddFunctions(batch.nodes);
+      scope_tree_window.AddFunctions(batch.nodes);
+      metrics_window.AddBatch(batch);
+      extracted.nodes.insert(extracted.nodes.end(), batch.nodes.begin(),
+                             batch.nodes.end());
+      extracted.edges.insert(extracted.edges.end(), batch.edges.begin(),
+                             batch.edges.end());
     }
+    each_view([](gui::GraphGui& view) { view.FinishMerge(); });
+    if (diff_pending && !extraction_worker.IsExtracting()) {
+      each_view([&](gui::GraphGui& view) {
+        if (view.aggregation_level() == aggregation::Level::Functions) {
+          view.set_collapsed_scopes(scope_tree_window.CollapsedScopes());
+          view.ApplyDiff(extracted);
+        } else {
+          reload(view);
+        }
+      });
+      for (auto& view : pinned_views) {
+        view->root = view->graph.root_function();
+      }
+      extraction_worker.ReleasePrevious();
+      diff_pending = false;
+      aggregates_stale = false;
+    }
+    if (aggregates_stale && !extraction_worker.IsExtracting()) {
+      each_view([&](gui::GraphGui& view) {
+        if (view.aggregation_level() != aggregation::Level::Functions)
+          reload(view);
+      });
+      aggregates_stale = false;
+    }
+    each_view([&](gui::GraphGui& view) {
+      if (view.aggregation_pending()) reload(view);
+    });
 
     if (windows_toggle_menu.show_source_code_window) {
       source_code_panel.Draw();
@@ -80,6 +256,48 @@ int main(int, char**) {
       functions_filtering_window.Draw();
     }
 
+    clang_interface::FunctionDecl* view_root;
+    bool callers;
+    if (functions_filtering_window.PopViewRequest(view_root, callers)) {
+      pinned_views.push_back(std::make_unique<PinnedGraphView>(
+          &io, &source_code_panel.Editor(), view_root, callers,
+          pinned_views_opened++));
+      pinned_views.back()->graph.init_renderer(main_window.GlslVersion());
+      reload(pinned_views.back()->graph);
+    }
+
+    if (windows_toggle_menu.show_extraction_settings_window) {
+      extraction_settings_window.Draw();
+    }
+
+    if (windows_toggle_menu.show_scope_tree_window) {
+      scope_tree_window.Draw();
+    }
+    if (scope_tree_window.CollapsedChanged()) {
+      each_view(reload);
+      scope_tree_window.CollapsedApplied();
+    }
+
+    if (windows_toggle_menu.show_symbol_search_window) {
+      symbol_search_window.Draw();
+    }
+    if (auto function = symbol_search_window.PopJumpRequest()) {
+      focus_request = function;
+    }
+
+    if (windows_toggle_menu.show_metrics_window) {
+      metrics_window.Draw(!extraction_worker.IsExtracting());
+    }
+    if (auto function = metrics_window.PopJumpRequest()) {
+      focus_request = function;
+    }
+    // The windows list functions of the new extraction, the views only know
+    // them once the diff is applied.
+    if (focus_request != nullptr && !diff_pending) {
+      graph.focus_node(focus_request);
+      focus_request = nullptr;
+    }
+
     if (windows_toggle_menu.show_ast_dump_window) {
       function_ast_dump_window.SetFunction(
           functions_filtering_window.LastClickedFunction());
@@ -87,8 +305,11 @@ int main(int, char**) {
     }
 
     if (windows_toggle_menu.show_callgraph_window) {
-      graph.draw(functions_filtering_window.LastClickedFunction());
+      graph.draw(diff_pending
+                     ? nullptr
+                     : functions_filtering_window.LastClickedFunction());
     }
+    for (auto& view : pinned_views) view->graph.draw(view->root);
     // Rendering
     ImGui::Render();
     int display_w, display_h;
@@ -99,6 +320,13 @@ int main(int, char**) {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     glfwSwapBuffers(main_window.Window());
+    windows_toggle_menu.frames_rendered++;
+    // Closed views go only now, their renderer callbacks were queued in the
+    // draw data rendered above.
+    pinned_views.erase(
+        std::remove_if(pinned_views.begin(), pinned_views.end(),
+                       [](const auto& view) { return !view->open; }),
+        pinned_views.end());
   }
 
   return 0;
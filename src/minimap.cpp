@@ -0,0 +1,97 @@
+#include "minimap.hpp"
+
+#include <algorithm>
+#include "gui.hpp"
+
+namespace gui {
+
+namespace {
+
+const ImU32 BACKGROUND_COLOR = IM_COL32(20, 20, 20, 200);
+const ImU32 HIDDEN_NODE_COLOR = IM_COL32(0, 90, 95, 255);
+const ImU32 VISIBLE_NODE_COLOR = IM_COL32(0, 247, 255, 255);
+const ImU32 VIEWPORT_COLOR = IM_COL32(255, 165, 0, 255);
+
+}  // namespace
+
+Minimap::~Minimap() {
+  if (texture) glDeleteTextures(1, &texture);
+}
+
+void Minimap::Update(const float* layout_x, const float* layout_y,
+                     const unsigned* active_parents, size_t count) {
+  extent_x = 1;
+  extent_y = 1;
+  for (size_t i = 0; i < count; i++) {
+    extent_x = std::max(extent_x, layout_x[i] + 1);
+    extent_y = std::max(extent_y, layout_y[i] + 1);
+  }
+
+  pixels.assign(TEXTURE_SIZE * TEXTURE_SIZE, BACKGROUND_COLOR);
+  float scale_x = TEXTURE_SIZE / extent_x;
+  float scale_y = TEXTURE_SIZE / extent_y;
+  // Visible nodes are drawn last so hidden ones never cover them
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < count; i++) {
+      bool visible = active_parents[i] != 0;
+      if (visible != (pass == 1)) continue;
+      int x = std::min(TEXTURE_SIZE - 1,
+                       static_cast<int>((layout_x[i] + 0.5f) * scale_x));
+      int y = std::min(TEXTURE_SIZE - 1,
+                       static_cast<int>((layout_y[i] + 0.5f) * scale_y));
+      pixels[y * TEXTURE_SIZE + x] =
+          visible ? VISIBLE_NODE_COLOR : HIDDEN_NODE_COLOR;
+    }
+  }
+
+  GLint last_texture;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+  if (!texture) {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  glBindTexture(GL_TEXTURE_2D, texture);
+#ifdef GL_UNPACK_ROW_LENGTH
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#endif
+  // ImU32 colors are RGBA in memory order on little endian machines
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TEXTURE_SIZE, TEXTURE_SIZE, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  glBindTexture(GL_TEXTURE_2D, last_texture);
+}
+
+bool Minimap::Draw(ImVec2 position, ImVec2 size, ImVec2 view_min,
+                   ImVec2 view_max, ImVec2& target) {
+  if (!texture) return false;
+
+  ImGui::SetCursorScreenPos(position);
+  ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<intptr_t>(texture)),
+               size);
+
+  auto to_screen = [&](ImVec2 layout) {
+    return ImVec2(position.x + layout.x / extent_x * size.x,
+                  position.y + layout.y / extent_y * size.y);
+  };
+  ImDrawList* draw_list = ImGui::GetWindowDrawList();
+  draw_list->PushClipRect(position,
+                          ImVec2(position.x + size.x, position.y + size.y),
+                          true);
+  draw_list->AddRect(to_screen(view_min), to_screen(view_max),
+                     VIEWPORT_COLOR);
+  draw_list->PopClipRect();
+
+  // Clicking jumps there, dragging keeps the view under the mouse
+  ImGui::SetCursorScreenPos(position);
+  ImGui::InvisibleButton("minimap", size);
+  if (!ImGui::IsItemActive()) return false;
+  ImVec2 mouse = ImGui::GetIO().MousePos;
+  target = ImVec2((mouse.x - position.x) / size.x * extent_x,
+                  (mouse.y - position.y) / size.y * extent_y);
+  return true;
+}
+
+};  // namespace gui
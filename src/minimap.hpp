@@ -0,0 +1,42 @@
+#ifndef MINIMAP_HPP
+#define MINIMAP_HPP
+
+#include <cstdint>
+#include <vector>
+#include "imgui.h"
+
+namespace gui {
+
+// Overview of the whole laid-out graph, rasterized on the CPU into a small
+// texture whenever the layout or the set of visible nodes changes. Drawing
+// it is a single textured quad and a viewport rectangle, so it costs the
+// same for any graph size.
+class Minimap {
+ private:
+  static constexpr int TEXTURE_SIZE = 256;
+
+  unsigned texture = 0;
+  std::vector<uint32_t> pixels;
+  // Layout extent mapped onto the texture
+  float extent_x = 1;
+  float extent_y = 1;
+
+ public:
+  Minimap() = default;
+  Minimap(const Minimap&) = delete;
+  Minimap& operator=(const Minimap&) = delete;
+  ~Minimap();
+
+  // Needs the current GL context.
+  void Update(const float* layout_x, const float* layout_y,
+              const unsigned* active_parents, size_t count);
+  // Draws the minimap with the part of the layout between view_min and
+  // view_max outlined. Returns true while it is clicked or dragged, target
+  // is then the layout position under the mouse.
+  bool Draw(ImVec2 position, ImVec2 size, ImVec2 view_min, ImVec2 view_max,
+            ImVec2& target);
+};
+
+};  // namespace gui
+
+#endif  // MINIMAP_HPP
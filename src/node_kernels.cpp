@@ -0,0 +1,170 @@
+#include "node_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NODE_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace node_kernels {
+
+namespace {
+
+// Also handles the tails the vectorized kernels leave over.
+size_t ScalarKernel(const NodeInput& input, const FrameParams& params,
+                    NodeOutput& output, size_t begin, size_t hit) {
+  float radius_sq = params.hit_radius * params.hit_radius;
+  for (size_t i = begin; i < input.count; i++) {
+    float x = input.layout_x[i] * params.scale_x + params.offset_x;
+    float y = input.layout_y[i] * params.scale_y + params.offset_y;
+    bool visible = input.active_parents[i] != 0 && x >= params.min_x &&
+                   x <= params.max_x && y >= params.min_y && y <= params.max_y;
+    output.screen_x[i] = x;
+    output.screen_y[i] = y;
+    output.on_screen[i] = visible;
+    float dx = params.hit_x - x;
+    float dy = params.hit_y - y;
+    if (params.hit_test && visible && dx * dx + dy * dy <= radius_sq) hit = i;
+  }
+  return hit;
+}
+
+size_t Scalar(const NodeInput& input, const FrameParams& params,
+              NodeOutput& output) {
+  return ScalarKernel(input, params, output, 0, NO_HIT);
+}
+
+#ifdef NODE_KERNELS_X86
+
+// Highest set lane of a hit mask, lanes are numbered from base.
+size_t LastLane(size_t base, int mask) {
+  return base + 31 - __builtin_clz(static_cast<unsigned>(mask));
+}
+
+// SSE2 is part of x86-64, so this one needs no target attribute there.
+__attribute__((target("sse2"))) size_t SSE2(const NodeInput& input,
+                                             const FrameParams& params,
+                                             NodeOutput& output) {
+  const __m128 scale_x = _mm_set1_ps(params.scale_x);
+  const __m128 scale_y = _mm_set1_ps(params.scale_y);
+  const __m128 offset_x = _mm_set1_ps(params.offset_x);
+  const __m128 offset_y = _mm_set1_ps(params.offset_y);
+  const __m128 min_x = _mm_set1_ps(params.min_x);
+  const __m128 min_y = _mm_set1_ps(params.min_y);
+  const __m128 max_x = _mm_set1_ps(params.max_x);
+  const __m128 max_y = _mm_set1_ps(params.max_y);
+  const __m128 hit_x = _mm_set1_ps(params.hit_x);
+  const __m128 hit_y = _mm_set1_ps(params.hit_y);
+  const __m128 radius_sq = _mm_set1_ps(params.hit_radius * params.hit_radius);
+  const __m128i zero = _mm_setzero_si128();
+
+  size_t hit = NO_HIT;
+  size_t i = 0;
+  for (; i + 4 <= input.count; i += 4) {
+    __m128 x = _mm_add_ps(
+        _mm_mul_ps(_mm_loadu_ps(input.layout_x + i), scale_x), offset_x);
+    __m128 y = _mm_add_ps(
+        _mm_mul_ps(_mm_loadu_ps(input.layout_y + i), scale_y), offset_y);
+    _mm_storeu_ps(output.screen_x + i, x);
+    _mm_storeu_ps(output.screen_y + i, y);
+
+    __m128i parents = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(input.active_parents + i));
+    __m128 hidden = _mm_castsi128_ps(_mm_cmpeq_epi32(parents, zero));
+    __m128 inside = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(x, min_x), _mm_cmple_ps(x, max_x)),
+        _mm_and_ps(_mm_cmpge_ps(y, min_y), _mm_cmple_ps(y, max_y)));
+    __m128 visible = _mm_andnot_ps(hidden, inside);
+    int visible_mask = _mm_movemask_ps(visible);
+    for (int lane = 0; lane < 4; lane++)
+      output.on_screen[i + lane] = (visible_mask >> lane) & 1;
+
+    if (params.hit_test && visible_mask) {
+      __m128 dx = _mm_sub_ps(hit_x, x);
+      __m128 dy = _mm_sub_ps(hit_y, y);
+      __m128 distance_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+      int hit_mask =
+          _mm_movemask_ps(_mm_and_ps(visible, _mm_cmple_ps(distance_sq,
+                                                           radius_sq)));
+      if (hit_mask) hit = LastLane(i, hit_mask);
+    }
+  }
+  return ScalarKernel(input, params, output, i, hit);
+}
+
+__attribute__((target("avx2"))) size_t AVX2(const NodeInput& input,
+                                             const FrameParams& params,
+                                             NodeOutput& output) {
+  const __m256 scale_x = _mm256_set1_ps(params.scale_x);
+  const __m256 scale_y = _mm256_set1_ps(params.scale_y);
+  const __m256 offset_x = _mm256_set1_ps(params.offset_x);
+  const __m256 offset_y = _mm256_set1_ps(params.offset_y);
+  const __m256 min_x = _mm256_set1_ps(params.min_x);
+  const __m256 min_y = _mm256_set1_ps(params.min_y);
+  const __m256 max_x = _mm256_set1_ps(params.max_x);
+  const __m256 max_y = _mm256_set1_ps(params.max_y);
+  const __m256 hit_x = _mm256_set1_ps(params.hit_x);
+  const __m256 hit_y = _mm256_set1_ps(params.hit_y);
+  const __m256 radius_sq =
+      _mm256_set1_ps(params.hit_radius * params.hit_radius);
+  const __m256i zero = _mm256_setzero_si256();
+
+  size_t hit = NO_HIT;
+  size_t i = 0;
+  for (; i + 8 <= input.count; i += 8) {
+    // No FMA here, so the results stay bit-identical to the scalar kernel.
+    __m256 x = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(input.layout_x + i), scale_x), offset_x);
+    __m256 y = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(input.layout_y + i), scale_y), offset_y);
+    _mm256_storeu_ps(output.screen_x + i, x);
+    _mm256_storeu_ps(output.screen_y + i, y);
+
+    __m256i parents = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(input.active_parents + i));
+    __m256 hidden = _mm256_castsi256_ps(_mm256_cmpeq_epi32(parents, zero));
+    __m256 inside = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(x, min_x, _CMP_GE_OQ),
+                      _mm256_cmp_ps(x, max_x, _CMP_LE_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(y, min_y, _CMP_GE_OQ),
+                      _mm256_cmp_ps(y, max_y, _CMP_LE_OQ)));
+    __m256 visible = _mm256_andnot_ps(hidden, inside);
+    int visible_mask = _mm256_movemask_ps(visible);
+    for (int lane = 0; lane < 8; lane++)
+      output.on_screen[i + lane] = (visible_mask >> lane) & 1;
+
+    if (params.hit_test && visible_mask) {
+      __m256 dx = _mm256_sub_ps(hit_x, x);
+      __m256 dy = _mm256_sub_ps(hit_y, y);
+      __m256 distance_sq =
+          _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+      int hit_mask = _mm256_movemask_ps(_mm256_and_ps(
+          visible, _mm256_cmp_ps(distance_sq, radius_sq, _CMP_LE_OQ)));
+      if (hit_mask) hit = LastLane(i, hit_mask);
+    }
+  }
+  return ScalarKernel(input, params, output, i, hit);
+}
+
+#endif  // NODE_KERNELS_X86
+
+KernelFunction SelectKernel() { return AvailableKernels().back().function; }
+
+}  // namespace
+
+std::vector<Kernel> AvailableKernels() {
+  std::vector<Kernel> kernels = {{"scalar", Scalar}};
+#ifdef NODE_KERNELS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) kernels.push_back({"sse2", SSE2});
+  if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", AVX2});
+#endif
+  return kernels;
+}
+
+size_t TransformCullHitTest(const NodeInput& input, const FrameParams& params,
+                            NodeOutput& output) {
+  static const KernelFunction kernel = SelectKernel();
+  return kernel(input, params, output);
+}
+
+};  // namespace node_kernels
@@ -0,0 +1,61 @@
+#ifndef NODE_KERNELS_HPP
+#define NODE_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-frame work over every node of the graph view: map layout positions to
+// screen positions, cull against the window and hit-test the mouse, all in a
+// single pass over the structure-of-arrays node data. Vectorized variants are
+// picked at runtime from what the CPU supports, the scalar one is always
+// available and is the reference the others must match.
+namespace node_kernels {
+
+constexpr size_t NO_HIT = ~size_t(0);
+
+struct NodeInput {
+  const float* layout_x;
+  const float* layout_y;
+  const unsigned* active_parents;  // a node is visible while this is nonzero
+  size_t count;
+};
+
+struct NodeOutput {
+  float* screen_x;
+  float* screen_y;
+  uint8_t* on_screen;
+};
+
+struct FrameParams {
+  // screen = layout * scale + offset
+  float scale_x, scale_y;
+  float offset_x, offset_y;
+  // Nodes whose top left corner falls inside this rect are on screen.
+  float min_x, min_y, max_x, max_y;
+  // Circle hit-test relative to the node's top left corner.
+  bool hit_test;
+  float hit_x, hit_y;  // mouse position minus the circle center offset
+  float hit_radius;
+};
+
+// Returns the last on-screen node containing the hit point, or NO_HIT. The
+// last one is the node drawn on top.
+using KernelFunction = size_t (*)(const NodeInput&, const FrameParams&,
+                                  NodeOutput&);
+
+struct Kernel {
+  const char* name;
+  KernelFunction function;
+};
+
+// Every kernel this CPU can run, best last.
+std::vector<Kernel> AvailableKernels();
+
+// Runs the best available kernel.
+size_t TransformCullHitTest(const NodeInput& input, const FrameParams& params,
+                            NodeOutput& output);
+
+};  // namespace node_kernels
+
+#endif  // NODE_KERNELS_HPP
@@ -0,0 +1,54 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity must be a power of two. TryPush leaves the value untouched
+// when the queue is full.
+template <typename T, size_t Capacity>
+class SPSCQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SPSCQueue capacity must be a power of two");
+
+ private:
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+  static constexpr size_t INDEX_MASK = Capacity - 1;
+
+  // head is only written by the consumer and tail only by the producer, they
+  // live on separate cache lines so the two threads don't share one.
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+  alignas(CACHE_LINE_SIZE) std::array<T, Capacity> slots;
+
+ public:
+  bool TryPush(T&& value) {
+    size_t current_tail = tail.load(std::memory_order_relaxed);
+    if (current_tail - head.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    slots[current_tail & INDEX_MASK] = std::move(value);
+    tail.store(current_tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPop(T& value) {
+    size_t current_head = head.load(std::memory_order_relaxed);
+    if (current_head == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(slots[current_head & INDEX_MASK]);
+    head.store(current_head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Empty() const {
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+  }
+};
+
+#endif  // SPSC_QUEUE_HPP
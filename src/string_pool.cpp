@@ -0,0 +1,83 @@
+#include "string_pool.hpp"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace string_pool {
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+class StringPool {
+ private:
+  std::mutex mutex;
+  std::unordered_set<std::string_view> strings;
+  std::vector<std::unique_ptr<char[]>> blocks;
+  char* block_cursor = nullptr;
+  size_t block_space = 0;
+  Stats stats;
+
+  char* Allocate(size_t size) {
+    // Big strings get a block of their own instead of wasting the rest of
+    // the current one.
+    if (size > BLOCK_SIZE / 4) {
+      blocks.push_back(std::make_unique<char[]>(size));
+      stats.reserved_bytes += size;
+      return blocks.back().get();
+    }
+    if (size > block_space) {
+      blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+      block_cursor = blocks.back().get();
+      block_space = BLOCK_SIZE;
+      stats.reserved_bytes += BLOCK_SIZE;
+    }
+    char* result = block_cursor;
+    block_cursor += size;
+    block_space -= size;
+    return result;
+  }
+
+ public:
+  std::string_view Intern(std::string_view str) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.intern_calls++;
+    stats.requested_bytes += str.size() + 1;
+
+    auto existing = strings.find(str);
+    if (existing != strings.end()) {
+      return *existing;
+    }
+    char* data = Allocate(str.size() + 1);
+    std::memcpy(data, str.data(), str.size());
+    data[str.size()] = '\0';
+    std::string_view interned(data, str.size());
+    strings.insert(interned);
+    stats.unique_strings++;
+    stats.stored_bytes += str.size() + 1;
+    return interned;
+  }
+
+  Stats GetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+};
+
+StringPool& GlobalPool() {
+  static StringPool pool;
+  return pool;
+}
+
+}  // namespace
+
+std::string_view Intern(std::string_view str) {
+  return GlobalPool().Intern(str);
+}
+
+Stats GetStats() { return GlobalPool().GetStats(); }
+
+};  // namespace string_pool
@@ -0,0 +1,28 @@
+#ifndef STRING_POOL_HPP
+#define STRING_POOL_HPP
+
+#include <cstddef>
+#include <string_view>
+
+// Process wide pool of interned strings. Equal strings share one copy, kept
+// in large arena blocks that are never freed, so the returned views stay
+// valid for the rest of the program. The viewed data is always followed by a
+// '\0', so view.data() can be handed to C string APIs such as ImGui::Text.
+// Safe to use from several threads.
+namespace string_pool {
+
+std::string_view Intern(std::string_view str);
+
+struct Stats {
+  size_t unique_strings = 0;
+  size_t intern_calls = 0;
+  size_t requested_bytes = 0;  // what separate copies would have used
+  size_t stored_bytes = 0;     // what the pool actually stores
+  size_t reserved_bytes = 0;   // arena blocks allocated so far
+};
+
+Stats GetStats();
+
+};  // namespace string_pool
+
+#endif  // STRING_POOL_HPP
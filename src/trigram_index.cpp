@@ -0,0 +1,60 @@
+#include "trigram_index.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+char ToLower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+uint32_t Trigram(const char* text) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(ToLower(text[0])))
+             << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(ToLower(text[1])))
+             << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(ToLower(text[2])));
+}
+
+}  // namespace
+
+void TrigramIndex::Add(std::string_view text) {
+  uint32_t id = texts++;
+  for (size_t i = 0; i + 3 <= text.size(); i++) {
+    auto& list = postings[Trigram(text.data() + i)];
+    // A trigram repeated within one text is only listed once.
+    if (list.empty() || list.back() != id) list.push_back(id);
+  }
+}
+
+void TrigramIndex::Clear() {
+  postings.clear();
+  texts = 0;
+}
+
+bool TrigramIndex::Candidates(std::string_view term,
+                              std::vector<uint32_t>& result) const {
+  result.clear();
+  if (term.size() < 3) return false;
+
+  std::vector<const std::vector<uint32_t>*> lists;
+  for (size_t i = 0; i + 3 <= term.size(); i++) {
+    auto found = postings.find(Trigram(term.data() + i));
+    if (found == postings.end()) return true;
+    lists.push_back(&found->second);
+  }
+  // Intersecting from the shortest list keeps every step small.
+  std::sort(lists.begin(), lists.end(), [](auto a, auto b) {
+    return a->size() != b->size() ? a->size() < b->size() : a < b;
+  });
+  lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+  result = *lists.front();
+  std::vector<uint32_t> intersection;
+  for (size_t i = 1; i < lists.size() && !result.empty(); i++) {
+    intersection.clear();
+    std::set_intersection(result.begin(), result.end(), lists[i]->begin(),
+                          lists[i]->end(), std::back_inserter(intersection));
+    result.swap(intersection);
+  }
+  return true;
+}
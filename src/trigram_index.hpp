@@ -0,0 +1,31 @@
+#ifndef TRIGRAM_INDEX_HPP
+#define TRIGRAM_INDEX_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Inverted index from every three character window of a text to the texts
+// containing it, for case insensitive substring search over many short texts
+// such as function names. Texts are numbered from 0 in the order they were
+// added. Matching is ASCII case insensitive, like ImGuiTextFilter.
+class TrigramIndex {
+ private:
+  // Sorted text numbers per lowercased trigram packed into the low 24 bits.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+  uint32_t texts = 0;
+
+ public:
+  void Add(std::string_view text);
+  void Clear();
+  size_t Size() const { return texts; }
+
+  // Texts that may contain term, in ascending order. Only a superset is
+  // returned, candidates still have to be checked against the term. Returns
+  // false when the term is shorter than a trigram and narrows nothing down,
+  // every text is a candidate then.
+  bool Candidates(std::string_view term, std::vector<uint32_t>& result) const;
+};
+
+#endif  // TRIGRAM_INDEX_HPP